@@ -51,6 +51,25 @@ namespace Au.Types {
 		/// </summary>
 		UIA = 0x200,
 
+		/// <summary>
+		/// Search in multiple threads. Can make faster when not inproc (flag <see cref="NotInProc"/>, or the default search method cannot be used), because then each property is retrieved with a slow cross-process call.
+		/// The results are the same as without this flag, and in the same order. Ignored when the default (inproc) search method is used.
+		/// </summary>
+		Parallel = 0x400,
+
+		/// <summary>
+		/// Cache the UI element tree of the window, and next time with this flag get only what changed. Can make repeated searches in the same window much faster, for example when waiting for a UI element (<see cref="elmFinder.Wait"/> etc).
+		/// Caches child lists, roles, names, states and rectangles. Changes are detected with accessibility events; if a window does not raise events when its UI elements change, results can be outdated.
+		/// Used only with the default (inproc) search method and when searching in a window, not in elm or controls specified with class or id. Cannot be used with flag <see cref="UIA"/>. The cache is freed when not used for 30 seconds.
+		/// </summary>
+		Cache = 0x800,
+
+		/// <summary>
+		/// When finding all matching UI elements with the default (inproc) search method, get them from the target process in parts. The first results are available sooner, the search uses less memory, and the search in the target process stops soon after the <i>also</i> callback returns <c>true</c>. Used with <see cref="elmFinder.FindAll"/> and with <i>also</i>.
+		/// Each part continues the search from the position of the last found element, saved as indices of its ancestors among their siblings. If UI elements before that position are added or removed meanwhile, results can contain duplicates or miss some elements.
+		/// </summary>
+		Chunks = 0x1000,
+
 		//Internal. See Enum_.AFFlags_Mark.
 		//Mark = 0x10000,
 	}
@@ -75,6 +75,9 @@ enum class eAF {
 	ClientArea = 8,
 	NotInProc = 0x100,
 	UIA = 0x200,
+	Parallel = 0x400,
+	Cache = 0x800,
+	Chunks = 0x1000,
 	Mark = 0x10000,
 	//used only in this dll
 	Marked_ = 0x40000000,
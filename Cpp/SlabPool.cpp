@@ -0,0 +1,179 @@
+#include "stdafx.h"
+#include "cpp.h"
+#include "SlabPool.h"
+
+struct alignas(16) SlabPool::_Unit {
+	_Chunk* chunk; //null if large or direct
+	UINT cls;
+	UINT size; //requested size. If direct, the allocated size is size + sizeof(_Unit).
+	//then user data, or _Unit* next if in the free list
+	_Unit*& Next() { return *(_Unit**)(this + 1); }
+};
+
+struct alignas(16) SlabPool::_Chunk {
+	_Chunk* next; //in _chunks
+	LPBYTE bump, end; //not yet used part
+	int cls, nLive;
+};
+
+static size_t _UnitSize(int cls) { return 16 + ((size_t)32 << cls); }
+static size_t _LargeSize(int k) { return (size_t)20480 << k; }
+
+SlabPool::SlabPool() noexcept {
+	ZEROTHIS;
+	InitializeSRWLock(&_lock);
+}
+
+SlabPool::~SlabPool() {
+	for (int c = c_nSmall; c < c_nSmall + c_nLarge; c++) {
+		for (_Unit* u = _free[c]; u; ) { _Unit* t = u; u = u->Next(); free(t); }
+	}
+	for (_Chunk* k = _chunks; k; ) { _Chunk* t = k; k = k->next; free(t); }
+}
+
+void* SlabPool::Alloc(size_t size) {
+	AcquireSRWLockExclusive(&_lock);
+	void* p = _Alloc(size);
+	if (p) {
+		_stats.nAlloc++;
+		if (size > _stats.largest) _stats.largest = size;
+	}
+	ReleaseSRWLockExclusive(&_lock);
+	return p;
+}
+
+void SlabPool::Free(void* p) {
+	if (p == null) return;
+	AcquireSRWLockExclusive(&_lock);
+	_stats.nFree++;
+	_Free(p);
+	ReleaseSRWLockExclusive(&_lock);
+}
+
+SlabPool::Stats SlabPool::GetStats() {
+	AcquireSRWLockShared(&_lock);
+	Stats r = _stats;
+	ReleaseSRWLockShared(&_lock);
+	return r;
+}
+
+size_t SlabPool::Trim() {
+	AcquireSRWLockExclusive(&_lock);
+	size_t r = _stats.reserved;
+	for (int c = c_nSmall; c < c_nSmall + c_nLarge; c++) {
+		for (_Unit* u = _free[c]; u; ) { _Unit* t = u; u = u->Next(); _SysFree(t, sizeof(_Unit) + _LargeSize(c - c_nSmall)); }
+		_free[c] = null; _nFree[c] = 0;
+	}
+	_stats.nLargeCached = 0; _cachedBytes = 0;
+
+	//remove free units of empty chunks from free lists, then free the chunks
+	for (int c = 0; c < c_nSmall; c++) {
+		_Unit** pu = &_free[c];
+		while (_Unit* u = *pu) {
+			if (u->chunk->nLive == 0) *pu = u->Next(); else pu = &u->Next();
+		}
+	}
+	for (_Chunk** pk = &_chunks; _Chunk* k = *pk; ) {
+		if (k->nLive == 0) {
+			*pk = k->next;
+			if (_current[k->cls] == k) _current[k->cls] = null;
+			_SysFree(k, c_chunkSize);
+			_stats.nChunks--;
+		} else pk = &k->next;
+	}
+	r -= _stats.reserved;
+	ReleaseSRWLockExclusive(&_lock);
+	return r;
+}
+
+void* SlabPool::_Alloc(size_t size) {
+	if (size <= 4096) {
+		int cls = 0;
+		while (((size_t)32 << cls) < size) cls++;
+		return _AllocSmall(cls, size);
+	}
+	for (int k = 0; k < c_nLarge; k++) if (size <= _LargeSize(k)) return _AllocLarge(c_nSmall + k, size);
+
+	if (size > UINT_MAX - sizeof(_Unit)) return null;
+	auto u = (_Unit*)_SysAlloc(size + sizeof(_Unit));
+	if (u == null) return null;
+	u->chunk = null; u->cls = c_direct; u->size = (UINT)size;
+	if ((_stats.live += size) > _stats.peakLive) _stats.peakLive = _stats.live;
+	return u + 1;
+}
+
+void* SlabPool::_AllocSmall(int cls, size_t size) {
+	_Unit* u = _free[cls];
+	if (u) {
+		_free[cls] = u->Next();
+	} else {
+		size_t z = _UnitSize(cls);
+		_Chunk* k = _current[cls];
+		if (k == null || k->bump + z > k->end) {
+			k = (_Chunk*)_SysAlloc(c_chunkSize);
+			if (k == null) return null;
+			k->next = _chunks; _chunks = k;
+			k->bump = (LPBYTE)(k + 1); k->end = (LPBYTE)k + c_chunkSize;
+			k->cls = cls; k->nLive = 0;
+			_current[cls] = k;
+			_stats.nChunks++;
+		}
+		u = (_Unit*)k->bump;
+		k->bump += z;
+		u->chunk = k; u->cls = cls;
+	}
+	u->size = (UINT)size;
+	u->chunk->nLive++;
+	if ((_stats.live += size) > _stats.peakLive) _stats.peakLive = _stats.live;
+	return u + 1;
+}
+
+void* SlabPool::_AllocLarge(int cls, size_t size) {
+	_Unit* u = _free[cls];
+	if (u) {
+		_free[cls] = u->Next();
+		_nFree[cls]--;
+		_stats.nLargeCached--;
+		_cachedBytes -= _LargeSize(cls - c_nSmall);
+	} else {
+		u = (_Unit*)_SysAlloc(sizeof(_Unit) + _LargeSize(cls - c_nSmall));
+		if (u == null) return null;
+		u->chunk = null; u->cls = cls;
+	}
+	u->size = (UINT)size;
+	if ((_stats.live += size) > _stats.peakLive) _stats.peakLive = _stats.live;
+	return u + 1;
+}
+
+void SlabPool::_Free(void* p) {
+	_Unit* u = (_Unit*)p - 1;
+	int cls = u->cls;
+	_stats.live -= u->size;
+	if (cls == c_direct) {
+		_SysFree(u, u->size + sizeof(_Unit));
+		return;
+	}
+	if (cls < c_nSmall) {
+		u->chunk->nLive--;
+	} else if (_nFree[cls] == c_maxCached || _cachedBytes + _LargeSize(cls - c_nSmall) > c_maxCachedBytes) {
+		_SysFree(u, sizeof(_Unit) + _LargeSize(cls - c_nSmall));
+		return;
+	} else {
+		_nFree[cls]++;
+		_stats.nLargeCached++;
+		_cachedBytes += _LargeSize(cls - c_nSmall);
+	}
+	u->Next() = _free[cls];
+	_free[cls] = u;
+}
+
+void* SlabPool::_SysAlloc(size_t size) {
+	void* p = malloc(size);
+	if (p && (_stats.reserved += size) > _stats.peakReserved) _stats.peakReserved = _stats.reserved;
+	return p;
+}
+
+void SlabPool::_SysFree(void* p, size_t size) {
+	free(p);
+	_stats.reserved -= size;
+}
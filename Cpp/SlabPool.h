@@ -0,0 +1,71 @@
+#pragma once
+
+//Memory allocator for PCRE match data and heap frames. Normally one instance per thread.
+//Thread-safe, because other threads can get stats. The lock is uncontended, except then.
+//Small sizes (up to 4 KB): size classes 32 B * 2^k. Units are carved from 64 KB chunks, one class per chunk. Free units are reused.
+//Large sizes: size classes 20480 * 2^k, because PCRE heap frames start at 20480 bytes (START_FRAMES_SIZE) and grow x2. Blocks are malloc-ed; a few free blocks of each class are kept for reuse, max 1 MB total.
+//Bigger than the biggest class: malloc/free.
+//Alloc and Free are O(1). Each unit has a 16-byte header with its class, size and chunk.
+class SlabPool {
+public:
+	struct Stats {
+		size_t reserved; //bytes allocated from the system: chunks, large blocks including free cached blocks, and big blocks
+		size_t live; //bytes currently allocated by callers (requested sizes)
+		size_t peakReserved, peakLive;
+		__int64 nAlloc, nFree; //number of Alloc and Free calls (except failed and Free(null))
+		size_t largest; //the largest size requested
+		int nChunks; //64 KB chunks for small units
+		int nLargeCached; //free large blocks kept for reuse
+
+		//Adds stats of another pool. Peaks are added too, therefore the result is their upper bound.
+		void Add(const Stats& t) {
+			reserved += t.reserved; live += t.live; peakReserved += t.peakReserved; peakLive += t.peakLive;
+			nAlloc += t.nAlloc; nFree += t.nFree; largest = max(largest, t.largest);
+			nChunks += t.nChunks; nLargeCached += t.nLargeCached;
+		}
+
+		//Returns 1 - live / reserved. It is the part of reserved memory not used by callers: free units and chunk space, cached blocks, rounding to class size.
+		double Fragmentation() const { return reserved ? 1 - (double)live / reserved : 0; }
+	};
+
+	SlabPool() noexcept;
+	~SlabPool();
+	SlabPool(const SlabPool&) = delete;
+
+	//Returns 16-byte aligned memory, or null if fails.
+	void* Alloc(size_t size);
+
+	//Frees memory allocated by Alloc of this pool. p can be null.
+	void Free(void* p);
+
+	//Gets a copy of stats. Can be called in any thread.
+	Stats GetStats();
+
+	//Frees cached large blocks and chunks that have no allocated units. Can be called in any thread.
+	//Returns the number of freed bytes.
+	size_t Trim();
+
+private:
+	struct _Chunk;
+	struct _Unit;
+	static const int c_nSmall = 8, c_nLarge = 9; //classes
+	static const int c_direct = c_nSmall + c_nLarge; //class of blocks bigger than the biggest class
+	static const size_t c_chunkSize = 64 * 1024;
+	static const int c_maxCached = 2; //max free large blocks of a class kept for reuse
+	static const size_t c_maxCachedBytes = 1024 * 1024; //max size of all free large blocks kept for reuse
+
+	_Unit* _free[c_nSmall + c_nLarge]; //free lists
+	int _nFree[c_nSmall + c_nLarge]; //used for large classes
+	size_t _cachedBytes; //of free large blocks
+	_Chunk* _current[c_nSmall]; //chunk for new units of the class
+	_Chunk* _chunks; //all chunks
+	Stats _stats;
+	SRWLOCK _lock;
+
+	void* _Alloc(size_t size);
+	void _Free(void* p);
+	void* _AllocSmall(int cls, size_t size);
+	void* _AllocLarge(int cls, size_t size);
+	void* _SysAlloc(size_t size);
+	void _SysFree(void* p, size_t size);
+};
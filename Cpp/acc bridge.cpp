@@ -2,7 +2,7 @@
 #include "cpp.h"
 #include "acc.h"
 
-HRESULT AccFind(AccFindCallback& callback, HWND w, Cpp_Acc* aParent, const Cpp_AccFindParams& ap, out BSTR& errStr);
+HRESULT AccFind(AccFindCallback& callback, HWND w, Cpp_Acc* aParent, const Cpp_AccFindParams& ap, out BSTR& errStr, AccFindPosition* pos = null);
 HRESULT AccFromPoint(POINT p, HWND wFP, eXYFlags flags, eSpecWnd specWnd, out Cpp_Acc& aResult);
 HRESULT AccGetFocused(HWND w, eFocusedFlags flags, out Cpp_Acc& aResult);
 HRESULT AccNavigate(Cpp_Acc aFrom, STR navig, out Cpp_Acc& aResult);
@@ -13,14 +13,17 @@ namespace {
 #pragma region marshal
 
 	//Used for marshaling 'find AO' (IPA_AccFind) parameters when calling the get_accHelpTopic hook function.
-	//A flat variable-size memory structure (strings follow the fixed-size part).
+	//A flat variable-size memory structure (the resume path and strings follow the fixed-size part).
 	struct MarshalParams_AccFind {
 		struct _FlatStr { int offs, len; };
 
 		MarshalParams_Header hdr;
 		int hwnd; //not HWND, because it must be of same size in 32 and 64 bit process
 		eAF2 flags2;
+		int maxFound; //if not 0, find-all results are returned in chunks. See AccFindPosition.
 	private:
+		int _resumeDepth; //AccFindPosition::depth. The path follows the fixed-size part.
+		int _resumeSkipChildren;
 		//these are the same as Cpp_AccFindParams, except is used int instead of STR. Cannot use STR because its size can be 32 or 64 bit.
 		_FlatStr _role, _name, _prop;
 		eAF _flags;
@@ -43,14 +46,24 @@ namespace {
 			return (STR)this + r.offs;
 		}
 	public:
-		static int CalcMemSize(const Cpp_AccFindParams& ap) {
-			return sizeof(MarshalParams_AccFind) + (ap.roleLength + ap.nameLength + ap.propLength + 3) * 2;
+		static int CalcMemSize(const Cpp_AccFindParams& ap, int resumeDepth = 0) {
+			return sizeof(MarshalParams_AccFind) + resumeDepth * 4 + (ap.roleLength + ap.nameLength + ap.propLength + 3) * 2;
 		}
 
-		void Marshal(HWND w, const Cpp_AccFindParams& ap) {
+		//pos - if not null, the server returns find-all results in chunks of pos->maxFound AO, starting at pos->path.
+		void Marshal(HWND w, const Cpp_AccFindParams& ap, const AccFindPosition* pos = null) {
 			hwnd = (int)(LPARAM)w;
 
-			auto s = (LPWSTR)(this + 1);
+			int depth = 0;
+			if (pos) {
+				maxFound = pos->maxFound;
+				depth = pos->depth;
+				_resumeSkipChildren = pos->skipChildren;
+				memcpy(this + 1, pos->path, depth * 4);
+			} else maxFound = 0;
+			_resumeDepth = depth;
+
+			auto s = (LPWSTR)((int*)(this + 1) + depth);
 			s = _SetString(ap.role, ap.roleLength, s, out _role);
 			s = _SetString(ap.name, ap.nameLength, s, out _name);
 			s = _SetString(ap.prop, ap.propLength, s, out _prop);
@@ -69,6 +82,16 @@ namespace {
 			ap.resultProp = _resultProp;
 			ap.flags2 = flags2;
 		}
+
+		//Returns false if results are not returned in chunks.
+		bool UnmarshalPosition(out AccFindPosition& pos) {
+			if (maxFound <= 0) return false;
+			pos.maxFound = maxFound;
+			pos.depth = min(max(_resumeDepth, 0), AccFindPosition::c_maxLevel);
+			pos.skipChildren = !!_resumeSkipChildren;
+			memcpy(pos.path, this + 1, pos.depth * 4);
+			return true;
+		}
 	};
 
 	static long s_accMarshalWrapperCount;
@@ -441,6 +464,8 @@ namespace inproc {
 			Cpp_Acc aParent(iacc, 0, h->miscFlags), aPrev;
 			DpiElmScaling des(getRects, w, null);
 			std::vector<_AccRect> agr;
+			AccFindPosition pos;
+			bool chunk = findAll && !getRects && p->UnmarshalPosition(out pos);
 
 			HRESULT hr2 = AccFind(
 				[&](Cpp_Acc a, int state, int nSiblings) mutable {
@@ -477,7 +502,7 @@ namespace inproc {
 				ge:
 					hr = RPC_E_SERVER_CANTMARSHAL_DATA;
 					return eAccFindCallbackResult::StopNotFound;
-				}, w, w ? null : &aParent, ref ap, out sResult);
+				}, w, w ? null : &aParent, ref ap, out sResult, chunk ? &pos : null);
 
 			if (hr2 != 0 && hr2 != (HRESULT)eError::NotFound) return hr2;
 			if (hr != 0) return hr;
@@ -496,6 +521,12 @@ namespace inproc {
 			} else {
 				if (ap.resultProp) return 0;
 			}
+
+			if (chunk) { //append the trailer (see InProcCall::ReadResultTrailer): depth, skipChildren, path, size
+				int t[2] = { pos.depth, pos.skipChildren };
+				DWORD size = (2 + pos.depth) * 4;
+				if (stream->Write(t, 8, null) || stream->Write(pos.path, pos.depth * 4, null) || stream->Write(&size, 4, null)) return RPC_E_SERVER_CANTMARSHAL_DATA;
+			}
 		}
 
 		DWORD streamSize, readSize;
@@ -524,7 +555,7 @@ namespace outproc {
 	//dontNeedAO - don't need AO. Only release marshal data if need.
 	HRESULT InProcCall::ReadResultAcc(ref Cpp_Acc& a, bool dontNeedAO/* = false*/, RECT* rect/* =null*/) {
 		if (!_stream) {
-			_resultSize = _br.ByteLength(); if (_resultSize == 0) return RPC_E_CLIENT_CANTUNMARSHAL_DATA;
+			_resultSize = _br.ByteLength() - _trailerSize; if (_resultSize == 0) return RPC_E_CLIENT_CANTUNMARSHAL_DATA;
 			HGLOBAL hg = GlobalAlloc(GMEM_MOVEABLE, _resultSize); if (hg == 0) return RPC_E_CLIENT_CANTUNMARSHAL_DATA;
 			LPVOID mem = GlobalLock(hg); memcpy(mem, _br, _resultSize); GlobalUnlock(mem);
 			if (0 != CreateStreamOnHGlobal(hg, true, &_stream)) return RPC_E_CLIENT_CANTUNMARSHAL_DATA;
@@ -686,32 +717,54 @@ namespace outproc {
 		}
 
 		if (inProc) {
-			InProcCall ic;
-			auto sizeofParams = MarshalParams_AccFind::CalcMemSize(ref ap);
-			auto p = (MarshalParams_AccFind*)ic.AllocParams(aParent, InProcAction::IPA_AccFind, sizeofParams);
-			p->Marshal(useWnd ? w : 0, ref ap);
-
-			if (0 != (R = ic.Call())) {
-				if (R == (HRESULT)eError::InvalidParameter) sResult = ic.DetachResultBSTR();
-			} else if (!findAll) {
-				if (!ap.resultProp) R = ic.ReadResultAcc(ref aResult);
-				else if (ap.resultProp != '-') sResult = ic.DetachResultBSTR();
-			} else {
-				Cpp_Acc a;
-				RECT rect = {};
-				int skip = ap.skip;
-				for (;;) {
-					R = ic.ReadResultAcc(ref a, false, &rect);
-					if (R) break; //NotFound when end of stream
-					if (!also(a, &rect)) continue; //must Release u.acc, preferably later
-					if (skip-- == 0) {
-						a.acc->AddRef();
-						aResult = a;
-						break;
+			//Flag Chunks: find-all results are returned in chunks. Then 'also' gets the first AO sooner, the data size is limited, and the finder stops when 'also' returns true.
+			//	Each chunk is a new call that continues the search from the position where the previous call stopped. The chunk size grows.
+			//	Not by default: if AO before the position are added or removed between calls, results can have duplicates or miss AO. And each call enumerates children of ancestors of the position again.
+			bool chunks = findAll && !getRects && !!(ap.flags & eAF::Chunks);
+			AccFindPosition pos; pos.maxFound = 1024; pos.depth = 0;
+			Cpp_Acc a;
+			RECT rect = {};
+			int skip = ap.skip;
+			for (;;) {
+				InProcCall ic;
+				auto sizeofParams = MarshalParams_AccFind::CalcMemSize(ref ap, pos.depth);
+				auto p = (MarshalParams_AccFind*)ic.AllocParams(aParent, InProcAction::IPA_AccFind, sizeofParams);
+				p->Marshal(useWnd ? w : 0, ref ap, chunks ? &pos : null);
+
+				if (0 != (R = ic.Call())) {
+					if (R == (HRESULT)eError::InvalidParameter) sResult = ic.DetachResultBSTR();
+				} else if (!findAll) {
+					if (!ap.resultProp) R = ic.ReadResultAcc(ref aResult);
+					else if (ap.resultProp != '-') sResult = ic.DetachResultBSTR();
+				} else {
+					if (chunks) {
+						DWORD size = 0; auto t = (const int*)ic.ReadResultTrailer(out size);
+						if (t && size >= 8 && t[0] >= 0 && t[0] <= AccFindPosition::c_maxLevel && size == (2 + t[0]) * 4) {
+							pos.depth = t[0];
+							pos.skipChildren = !!t[1];
+							memcpy(pos.path, t + 2, pos.depth * 4);
+						} else pos.depth = 0;
+					}
+
+					for (;;) {
+						R = ic.ReadResultAcc(ref a, false, &rect);
+						if (R) break; //NotFound when end of stream
+						if (!also(a, &rect)) continue; //must Release u.acc, preferably later
+						if (skip-- == 0) {
+							a.acc->AddRef();
+							aResult = a;
+							break;
+						}
+					}
+					//release the marshal data of remaining AO
+					for (auto k = R; k == 0; ) k = ic.ReadResultAcc(ref a, true, &rect);
+
+					if (R == (HRESULT)eError::NotFound && pos.depth > 0) { //the finder stopped after pos.maxFound AO
+						pos.maxFound = min(pos.maxFound * 2, 65536);
+						continue;
 					}
 				}
-				//release the marshal data of remaining AO
-				for (auto k = R; k == 0; ) k = ic.ReadResultAcc(ref a, true, &rect);
+				break;
 			}
 			//Perf.Next();
 		} else {
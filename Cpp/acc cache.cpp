@@ -0,0 +1,385 @@
+#include "stdafx.h"
+#include "cpp.h"
+#include "acc.h"
+
+//Incremental cache of AO trees, for repeated finds in the same window (flag eAF::Cache), eg when waiting for an AO.
+//	Without it, each find (each period of a wait loop) gets all children and properties of all AO again. With it, gets only what changed since the previous find.
+//A cache is created for a window when first used. Used only inproc, in the thread of the window. Don't need to lock.
+//Changes are detected with an in-context WinEvent hook for this thread. The hook only records events. The next find resolves them:
+//	Gets the AO from the event (AccessibleObjectFromEvent), finds its node by COM identity, and marks dirty:
+//		CREATE, DESTROY, SHOW, HIDE - the child list of its parent (and state if SHOW, HIDE);
+//		REORDER - its child list; NAMECHANGE - its name; STATECHANGE, SELECTIONADD, SELECTIONREMOVE - its state;
+//		SELECTION - states of its siblings; SELECTIONWITHIN - states in its subtree; LOCATIONCHANGE - rects and states (OFFSCREEN) in its subtree.
+//	FOCUS marks dirty all states, because the previously focused AO is unknown.
+//	If the AO is not in the cache (eg new), marks dirty the child list of its nearest cached ancestor.
+//	If cannot get the AO or a cached ancestor (eg destroyed, or an oleacc proxy which is a new object each time), marks dirty all child lists.
+//When getting a dirty child list, reuses the nodes (with their subtrees and properties) of children that are still there (same COM identity).
+//	Then AccessibleChildren is called again for each node, but properties are not.
+//Other properties (value, description, HTML attributes etc) are not cached.
+//Subtrees of child windows of other threads are not cached (all their data is marked dirty in each find), because the hook does not receive their events.
+//Caches not used for some time are freed.
+
+namespace acccache {
+	const int c_maxPending = 200; //if more events, it's faster to mark all dirty than resolve each
+	const int c_maxCaches = 8; //max caches per thread. When more, frees the least recently used.
+	const DWORD c_freeAfter = 30000; //free a cache if not used for this time, ms
+	const DWORD c_timerPeriod = 10000; //ms
+
+	//Gets the COM identity of an AO.
+	static IUnknown* _Identity(IAccessible* acc) {
+		IUnknown* u = null;
+		if (0 != acc->QueryInterface(IID_IUnknown, (void**)&u)) return acc;
+		u->Release(); //the object is alive while we hold acc
+		return u;
+	}
+
+	//Node index sorted by identity and elem.
+	struct _Index {
+		struct _Item { IUnknown* id; long elem; int i; };
+		std::vector<_Item> a;
+
+		static bool _Less(const _Item& x, const _Item& y) {
+			return x.id != y.id ? x.id < y.id : x.elem < y.elem;
+		}
+
+		void Sort() { std::sort(a.begin(), a.end(), _Less); }
+
+		//Returns index of the item, or -1.
+		int Find(IUnknown* id, long elem) const {
+			_Item k = { id, elem };
+			auto it = std::lower_bound(a.begin(), a.end(), k, _Less);
+			return (it != a.end() && it->id == id && it->elem == elem) ? it->i : -1;
+		}
+	};
+
+	static void _ClearFlagInSubtree(AccCacheNode* x, BYTE flag) {
+		x->has &= ~flag;
+		for (auto c : x->children) _ClearFlagInSubtree(c, flag);
+	}
+
+	//Marks dirty all data in subtrees of WINDOW nodes of other threads.
+	static void _ClearForeign(AccCacheNode* x) {
+		if (x->foreign) _ClearFlagInSubtree(x, AccCacheNode::HasChildren | AccCacheNode::HasName | AccCacheNode::HasState | AccCacheNode::HasRect);
+		else for (auto c : x->children) _ClearForeign(c);
+	}
+
+	struct _Event { DWORD event; HWND w; LONG idObject, idChild; };
+
+	class _Cache {
+		std::vector<_Event> _pending;
+		std::vector<AccCacheNode*> _nodes; //used by _Resolve
+		_Index _index;
+	public:
+		HWND w;
+		bool inCLIENT, dirtyAll;
+		int maxcc;
+		ULONGLONG timeUsed;
+		AccCacheNode* root;
+
+		_Cache(HWND w_, bool inCLIENT_) {
+			w = w_; inCLIENT = inCLIENT_; dirtyAll = false; maxcc = 0; timeUsed = 0;
+			root = null;
+			AccRaw a;
+			if (0 != ao::AccFromWindowSR(w, inCLIENT ? OBJID_CLIENT : OBJID_WINDOW, &a.acc)) return;
+			root = new AccCacheNode(null, a, _Identity(a.acc));
+			root->a.misc.roleByte = inCLIENT ? ROLE_SYSTEM_CLIENT : ROLE_SYSTEM_WINDOW; //like AccFinder. Not important: can be not CLIENT (eg DIALOG).
+			root->varRole = (long)root->a.misc.roleByte;
+			root->has = AccCacheNode::HasRole;
+		}
+
+		~_Cache() { delete root; }
+
+		//Called by the hook proc.
+		void AddEvent(DWORD event, HWND hwnd, LONG idObject, LONG idChild) {
+			if (dirtyAll) return;
+			if (_pending.size() >= c_maxPending) {
+				dirtyAll = true;
+				_pending.clear();
+			} else _pending.push_back({ event, hwnd, idObject, idChild });
+		}
+
+		//Marks dirty the data changed since the previous call, according to the recorded events.
+		void Update() {
+			//AO functions called here can raise events. The hook proc adds them to the new _pending; they will be resolved the next time.
+			std::vector<_Event> pending; pending.swap(_pending);
+			bool all = dirtyAll; dirtyAll = false;
+			if (!all && !pending.empty()) {
+				_nodes.clear(); _index.a.clear();
+				_AddToIndex(root);
+				_index.Sort();
+				bool focus = false;
+				for (auto& e : pending) {
+					if (e.event == EVENT_OBJECT_FOCUS) { focus = true; continue; }
+					if (!_Resolve(e)) { all = true; break; }
+				}
+				_nodes.clear(); _index.a.clear();
+				if (focus && !all) _ClearFlagInSubtree(root, AccCacheNode::HasState);
+			}
+			//Events that were dropped or not resolved could be of any kind. Reused nodes keep their identity, therefore need to get all properties again.
+			if (all) _ClearFlagInSubtree(root, AccCacheNode::HasChildren | AccCacheNode::HasName | AccCacheNode::HasState | AccCacheNode::HasRect);
+			else _ClearForeign(root);
+		}
+
+	private:
+		void _AddToIndex(AccCacheNode* x) {
+			_index.a.push_back({ x->id, x->a.elem, (int)_nodes.size() });
+			_nodes.push_back(x);
+			for (auto c : x->children) _AddToIndex(c);
+		}
+
+		AccCacheNode* _Find(IAccessible* acc, long elem) {
+			int i = _index.Find(_Identity(acc), elem);
+			return i < 0 ? null : _nodes[i];
+		}
+
+		//Returns false if cannot find the node of the event AO or of its ancestor.
+		bool _Resolve(const _Event& e) {
+			Smart<IAccessible> acc; _variant_t v;
+			if (0 != AccessibleObjectFromEvent(e.w, e.idObject, e.idChild, &acc, &v) || !acc) return false;
+			long elem = v.vt == VT_I4 ? v.lVal : 0;
+
+			if (AccCacheNode* x = _Find(acc, elem)) {
+				auto parent = x->parent ? x->parent : x;
+				switch (e.event) {
+				case EVENT_OBJECT_CREATE: case EVENT_OBJECT_DESTROY:
+					parent->has &= ~AccCacheNode::HasChildren;
+					break;
+				case EVENT_OBJECT_SHOW: case EVENT_OBJECT_HIDE:
+					parent->has &= ~AccCacheNode::HasChildren;
+					x->has &= ~AccCacheNode::HasState;
+					break;
+				case EVENT_OBJECT_REORDER:
+					x->has &= ~AccCacheNode::HasChildren;
+					break;
+				case EVENT_OBJECT_NAMECHANGE:
+					x->has &= ~AccCacheNode::HasName;
+					break;
+				case EVENT_OBJECT_STATECHANGE:
+					x->has &= ~AccCacheNode::HasState;
+					//AccChildren removes invisible nonclient children of WINDOW
+					if (parent->a.misc.roleByte == ROLE_SYSTEM_WINDOW) parent->has &= ~AccCacheNode::HasChildren;
+					break;
+				case EVENT_OBJECT_SELECTIONADD: case EVENT_OBJECT_SELECTIONREMOVE:
+					x->has &= ~AccCacheNode::HasState;
+					break;
+				case EVENT_OBJECT_SELECTION: //x selected, siblings unselected
+					_ClearFlagInSubtree(parent, AccCacheNode::HasState);
+					break;
+				case EVENT_OBJECT_SELECTIONWITHIN: //x is the container
+					_ClearFlagInSubtree(x, AccCacheNode::HasState);
+					break;
+				case EVENT_OBJECT_LOCATIONCHANGE: //also OFFSCREEN can change, eg when scrolling; many frameworks don't send STATECHANGE then
+					_ClearFlagInSubtree(x, AccCacheNode::HasRect | AccCacheNode::HasState);
+					break;
+				}
+				return true;
+			}
+
+			//not in the cache (eg new). Find the nearest cached ancestor and mark dirty its child list.
+			AccCacheNode* x = elem ? _Find(acc, 0) : null;
+			Smart<IAccessible> a = acc;
+			for (int i = 0; !x && i < 100; i++) {
+				Smart<IDispatch> d; Smart<IAccessible> ap;
+				if (0 != a->get_accParent(&d) || !d || 0 != d->QueryInterface(&ap) || !ap) return false;
+				a = ap;
+				x = _Find(a, 0);
+			}
+			if (!x) return false;
+			x->has &= ~AccCacheNode::HasChildren;
+			return true;
+		}
+	};
+
+	//Caches of a thread, the WinEvent hook and the timer that frees unused caches.
+	struct _Thread {
+		std::vector<_Cache*> caches;
+		HWINEVENTHOOK hook = 0;
+		UINT_PTR timer = 0;
+		_Cache* busy = null; //the cache used between AccCacheGet and AccCacheRelease. Then caches must not be freed or modified by a reentrant call.
+
+		~_Thread() {
+			if (hook) UnhookWinEvent(hook);
+			if (timer) KillTimer(0, timer);
+			for (auto c : caches) delete c;
+		}
+
+		_Cache* Find(HWND w, bool inCLIENT) {
+			for (auto c : caches) if (c->w == w && c->inCLIENT == inCLIENT) return c;
+			return null;
+		}
+
+		void Free(int i) {
+			delete caches[i];
+			caches.erase(caches.begin() + i);
+		}
+	};
+	thread_local _Thread* t_thread;
+
+	static void CALLBACK _WinEventProc(HWINEVENTHOOK hook, DWORD event, HWND w, LONG idObject, LONG idChild, DWORD idEventThread, DWORD time) {
+		auto t = t_thread; if (!t) return;
+		switch (event) {
+		case EVENT_OBJECT_CREATE: case EVENT_OBJECT_DESTROY: case EVENT_OBJECT_SHOW: case EVENT_OBJECT_HIDE: case EVENT_OBJECT_REORDER:
+		case EVENT_OBJECT_NAMECHANGE: case EVENT_OBJECT_STATECHANGE: case EVENT_OBJECT_LOCATIONCHANGE:
+		case EVENT_OBJECT_FOCUS: case EVENT_OBJECT_SELECTION: case EVENT_OBJECT_SELECTIONADD: case EVENT_OBJECT_SELECTIONREMOVE: case EVENT_OBJECT_SELECTIONWITHIN: //FOCUSED, SELECTED; often without STATECHANGE
+			break;
+		default: return; //value, description etc
+		}
+		if (idObject == OBJID_CARET || idObject == OBJID_CURSOR) return;
+
+		for (auto c : t->caches) {
+			if (w == 0) c->dirtyAll = true; //unknown window
+			else if (w == c->w || IsChild(c->w, w)) {
+				if (w == c->w && event == EVENT_OBJECT_DESTROY && idObject == OBJID_WINDOW && idChild == CHILDID_SELF) c->dirtyAll = true; //the timer will free the cache
+				else c->AddEvent(event, w, idObject, idChild);
+			}
+		}
+	}
+
+	static void _ThreadEnd() {
+		delete t_thread; t_thread = null;
+	}
+
+	static void CALLBACK _TimerProc(HWND hwnd, UINT msg, UINT_PTR idEvent, DWORD time) {
+		auto t = t_thread; if (!t || t->busy) return;
+		auto now = GetTickCount64();
+		for (int i = (int)t->caches.size(); --i >= 0; ) {
+			auto c = t->caches[i];
+			if (now - c->timeUsed > c_freeAfter || !IsWindow(c->w)) t->Free(i);
+		}
+		if (t->caches.empty()) _ThreadEnd();
+	}
+}
+
+AccCacheNode* AccCacheGet(HWND w, bool inCLIENT, int maxcc) {
+	using namespace acccache;
+	if (GetWindowThreadProcessId(w, null) != GetCurrentThreadId()) return null;
+
+	auto t = t_thread;
+	if (t && t->busy) return null; //reentrant call, eg while a COM call of AccFinder dispatches an incoming call
+	if (!t) {
+		t = new _Thread();
+		t->hook = SetWinEventHook(EVENT_OBJECT_CREATE, EVENT_OBJECT_NAMECHANGE, s_moduleHandle, _WinEventProc, GetCurrentProcessId(), GetCurrentThreadId(), WINEVENT_INCONTEXT);
+		t->timer = SetTimer(0, 0, c_timerPeriod, _TimerProc);
+		if (!t->hook || !t->timer) { delete t; return null; }
+		t_thread = t;
+	}
+
+	_Cache* c = t->Find(w, inCLIENT);
+	if (!c) {
+		c = new _Cache(w, inCLIENT);
+		if (!c->root) { delete c; return null; }
+		if (t->caches.size() >= c_maxCaches) { //free the least recently used
+			int j = 0;
+			for (int i = 1; i < (int)t->caches.size(); i++) if (t->caches[i]->timeUsed < t->caches[j]->timeUsed) j = i;
+			t->Free(j);
+		}
+		t->caches.push_back(c);
+		c->maxcc = maxcc;
+	} else if (c->maxcc != maxcc) { //AccChildren gets 0 children if there are more than maxcc
+		c->maxcc = maxcc;
+		c->dirtyAll = true;
+	}
+
+	t->busy = c;
+	c->Update();
+	c->timeUsed = GetTickCount64();
+	return c->root;
+}
+
+void AccCacheRelease() {
+	if (auto t = acccache::t_thread) {
+		if (t->busy) t->busy->timeUsed = GetTickCount64();
+		t->busy = null;
+	}
+}
+
+void AccCacheThreadEnd() {
+	acccache::_ThreadEnd();
+}
+
+AccCacheNode::AccCacheNode(AccCacheNode* parent_, ref const AccRaw& a_, IUnknown* id_) : a(a_), id(id_), parent(parent_) {
+	state = 0;
+	rect[0] = rect[1] = rect[2] = rect[3] = 0;
+	has = 0;
+	foreign = false;
+}
+
+AccCacheNode::~AccCacheNode() {
+	for (auto x : children) delete x;
+	if (a.elem == 0) a.acc->Release();
+}
+
+int AccCacheNode::Children(ref AccContext& context) {
+	if (has & HasChildren) return (int)children.size();
+	has |= HasChildren;
+	if (!(has & HasRole)) { _variant_t vr; Role(out vr); } //AccChildren uses misc.roleByte
+
+	std::vector<AccCacheNode*> old; old.swap(children);
+	acccache::_Index index;
+	if (old.size() > 8) { //else linear search
+		for (int i = 0; i < (int)old.size(); i++) index.a.push_back({ old[i]->id, old[i]->a.elem, i });
+		index.Sort();
+	}
+
+	AccChildren c(ref context, ref a);
+	children.reserve(max(c.Count(), 0));
+	for (;;) {
+		AccRaw k;
+		if (!c.GetNext(out k)) break;
+		IUnknown* kid = k.elem ? id : acccache::_Identity(k.acc);
+
+		//reuse the node if the child was there the previous time
+		int i = -1;
+		if (index.a.size()) i = index.Find(kid, k.elem);
+		else for (int j = 0; j < (int)old.size(); j++) if (old[j] && old[j]->id == kid && old[j]->a.elem == k.elem) { i = j; break; }
+		if (i >= 0 && old[i]) {
+			children.push_back(old[i]); old[i] = null;
+			if (k.elem == 0) k.acc->Release();
+		} else {
+			auto x = new AccCacheNode(this, k, kid);
+			children.push_back(x);
+			//A child window of another thread? Then the hook does not receive its events. Need the role anyway; the finder gets it next.
+			if (k.elem == 0 && (a.misc.roleByte == ROLE_SYSTEM_CLIENT || a.misc.roleByte == ROLE_SYSTEM_WINDOW)) {
+				_variant_t vr; HWND hw;
+				if (x->Role(out vr) == ROLE_SYSTEM_WINDOW && 0 == WindowFromAccessibleObject(k.acc, &hw) && hw && GetWindowThreadProcessId(hw, null) != GetCurrentThreadId()) x->foreign = true;
+			}
+		}
+	}
+
+	for (auto x : old) delete x;
+	return (int)children.size();
+}
+
+BYTE AccCacheNode::Role(out _variant_t& vr) {
+	if (!(has & HasRole)) {
+		a.misc.roleByte = a.GetRoleByteAndVariant(out varRole);
+		has |= HasRole;
+	}
+	vr = varRole;
+	return a.misc.roleByte;
+}
+
+BSTR AccCacheNode::Name() {
+	if (!(has & HasName)) {
+		name.Empty();
+		if (0 != a.acc->get_accName(ao::VE(a.elem), &name)) name.Empty();
+		has |= HasName;
+	}
+	return name;
+}
+
+long AccCacheNode::State() {
+	if (!(has & HasState)) {
+		a.get_accState(out state);
+		has |= HasState;
+	}
+	return state;
+}
+
+const long* AccCacheNode::Rect() {
+	if (!(has & HasRect)) {
+		if (0 != a.acc->accLocation(&rect[0], &rect[1], &rect[2], &rect[3], ao::VE(a.elem))) rect[0] = rect[1] = rect[2] = rect[3] = 0;
+		has |= HasRect;
+	}
+	return rect;
+}
@@ -13,13 +13,26 @@ bool AccMatchHtmlAttributes(IAccessible* iacc, NameValue* prop, int count);
 bool AccChromeEnableHtml(IAccessible* aDoc);
 
 class AccFinder {
+	//used by the predicate planner, see _MatchPlanned
+	enum _eKind { _kName, _kValue, _kDesc, _kHelp, _kAction, _kKey, _kUiaid, _kUiacn, _kState, _kRect, _kHtml, _nKinds };
+	struct _Pred {
+		BYTE kind; //_eKind
+		short iProp; //index in _prop, if a string prop
+		int nEval, nPass;
+	};
+	struct _Planner {
+		_Pred* preds; //in the planned order
+		int nPreds;
+		int nCalls, provider; //_Plan is called every 32 AO and when the provider type changes
+	};
+
 	//these have ctors
 	AccContext _context; //shared memory buffer and maxcc
 	str::Wildex _controlClass; //used when the prop parameter has "class=x". Then _flags2 has eAF2::InControls.
 	str::Wildex _name; //name. If the name parameter is null, _name.Is()==false.
 	//Bstr _roleStrings; //a copy of the input role string when eg need to parse (modify) the string
-	Bstr _propStrings; //a copy of the input prop string when eg need to parse (modify) the string
 	str::Wildex _url; //Chrome DOCUMENT URL. Specified in the prop parameter. Used by FindDocumentSimple_.
+	Arena<2000> _arena; //memory for _prop, _notin and the copy of the prop string. Then typical finders don't use the heap when parsing parameters (Wildex uses ParseCached).
 
 	//our ctor ZEROTHISFROM(_callback)
 	AccFindCallback* _callback; //receives found AO
@@ -40,6 +53,12 @@ class AccFinder {
 	void* _findDOCUMENT; //used by FindDocumentSimple_, else null
 	BSTR* _errStr; //error string, when a parameter is invalid
 	HWND _wTL; //window in which currently searching
+	bool _parallel; //flag Parallel can be used
+	_Planner _planner; //predicate planner. See _MatchPlanned.
+	AccCacheNode* _cnode; //flag Cache: node of the AO passed to _Match, else null. Then _Match gets role, name, state and rect from the node.
+	AccFindPosition* _pos; //not null when getting find-all results in chunks. See _Resume.
+	int* _curPath; //when _pos: path of the current AO, like AccFindPosition::path
+	int _resumeDepth; //when continuing: the number of _pos->path elements not passed yet
 
 	bool _Error(STR es) {
 		if (_errStr) *_errStr = SysAllocString(es);
@@ -53,7 +72,7 @@ class AccFinder {
 
 	void _ParseNotin(LPWSTR s, LPWSTR eos) {
 		_notinCount = (int)std::count(s, eos, ',') + 1;
-		_notin = new STR[_notinCount];
+		_notin = _arena.Alloc<STR>(_notinCount);
 		int i = 0;
 		for (LPWSTR start = s; s <= eos; ) {
 			if (*s == ',' || s == eos) {
@@ -112,8 +131,8 @@ class AccFinder {
 		if (prop == null) return true;
 
 		int elemCount = (int)std::count(prop, prop + propLen, '\0') + 1;
-		_prop = new NameValue[elemCount]; _propCount = 0; //info: finally can be _propCount<elemCount, ie not all elements used
-		LPWSTR s0 = _propStrings.Assign(prop, propLen), s2, s3;
+		_prop = _arena.Alloc<NameValue>(elemCount); _propCount = 0; //info: finally can be _propCount<elemCount, ie not all elements used. Ctors are called when used.
+		LPWSTR s0 = _arena.CopyString(prop, propLen), s2, s3; //a copy of the input prop string, because need to parse (modify) the string
 		for (LPWSTR s = s0, na = s0, va = null, eos = s0 + propLen; s <= eos; s++) {
 			auto c = *s;
 			if (c == 0) {
@@ -123,12 +142,13 @@ class AccFinder {
 
 					bool addToProp = true;
 					if (na[0] != '@') { //HTML attribute names have prefix "@"
-						int i = str::Switch(na, va - 1 - na, {
+						static constexpr str::SwitchTable s_names({
 							L"value", L"desc", L"help", L"action", L"key", L"uiaid", L"uiacn", //string props
 							L"state", L"level", L"maxcc", L"notin", L"rect", L"item",
 							L"class", L"id", //control
 							L"url"
 							});
+						int i = s_names.Switch(na, va - 1 - na);
 
 						if (i == 0) return _Error(L"Unknown name in prop. For HTML attributes use prefix @.");
 						const int nStrProp = 7;
@@ -164,7 +184,7 @@ class AccFinder {
 								_flags2 |= eAF2::IsElem;
 								break;
 							case 7:
-								if (!_controlClass.Parse(va, len, true, _errStr)) return false;
+								if (!_controlClass.ParseCached(va, len, _errStr)) return false;
 								_flags2 |= eAF2::InControls;
 								break;
 							case 8:
@@ -175,16 +195,16 @@ class AccFinder {
 								_flags2 |= eAF2::InControls;
 								break;
 							case 9:
-								if (!_url.Parse(va, len, true, _errStr)) return false;
+								if (!_url.ParseCached(va, len, _errStr)) return false;
 								break;
 							}
 						}
 					}
 					if (addToProp) {
 						assert(_propCount < elemCount);
-						NameValue& x = _prop[_propCount++];
+						NameValue& x = *new(_prop + _propCount++) NameValue();
 						x.name = na;
-						if (!x.value.Parse(va, s - va, true, _errStr)) return false;
+						if (!x.value.ParseCached(va, s - va, _errStr)) return false;
 					}
 				}
 				while (++s <= eos && *s <= ' '); //allow space before name, eg "name1=value1\0 name2=..."
@@ -209,8 +229,7 @@ public:
 	}
 
 	~AccFinder() {
-		delete[] _prop;
-		delete[] _notin;
+		for (int i = 0; i < _propCount; i++) _prop[i].~NameValue();
 	}
 
 	bool SetParams(const Cpp_AccFindParams& ap) {
@@ -218,8 +237,9 @@ public:
 		_flags2 = ap.flags2;
 		//if(!_ParseRole(ap.role, ap.roleLength)) return false;
 		_role = ap.role;
-		if (ap.name != null && !_name.Parse(ap.name, ap.nameLength, true, _errStr)) return false;
+		if (ap.name != null && !_name.ParseCached(ap.name, ap.nameLength, _errStr)) return false;
 		if (!_ParseProp(ap.prop, ap.propLength)) return false;
+		_InitPlanner();
 
 		if (!!(_flags2 & eAF2::InWebPage)) {
 			_flags |= eAF::MenuToo;
@@ -231,10 +251,24 @@ public:
 		return true;
 	}
 
-	HRESULT Find(HWND w, const Cpp_Acc* a, AccFindCallback* callback) {
+	//pos - if not null, stops after finding pos->maxFound AO, and the next call can continue from there. See AccFindPosition.
+	HRESULT Find(HWND w, const Cpp_Acc* a, AccFindCallback* callback, AccFindPosition* pos = null) {
 		assert(!!w == !a);
 		_callback = callback;
 
+		if (pos && !(_flags2 & eAF2::InControls)) { //else finds all in single call (sets pos->depth = 0)
+			_pos = pos;
+			_curPath = _arena.Alloc<int>(AccFindPosition::c_maxLevel);
+			_curPath[0] = 0; //not used when web
+			_resumeDepth = min(pos->depth, AccFindPosition::c_maxLevel);
+		}
+		if (pos) pos->depth = pos->nFound = 0;
+
+		//Parallel search makes faster only when not inproc, where the speed is limited by the latency of cross-process calls.
+		//	Not with modes where the callback result is needed while searching.
+		_parallel = !!(_flags & eAF::Parallel) && !!(_flags2 & eAF2::NotInProc) && callback && !_findDOCUMENT
+			&& !(_flags & eAF::Mark) && !(_flags2 & eAF2::GetRects) && !_pos;
+
 		if (a) {
 			if (!!(_flags2 & eAF2::InWebPage)) return _ErrorHR(L"Don't use role prefix when searching in elm.");
 			if (!!(_flags2 & eAF2::InControls)) return _ErrorHR(L"Don't use class/id when searching in elm.");
@@ -252,7 +286,13 @@ public:
 				//Perf.NW();
 				if (hr) return hr;
 
-				switch (_Match(ref aDoc, 0)) {
+				if (_resumeDepth > 0) { //continuing after DOCUMENT (path[0] not used) or its descendant
+					if (_resumeDepth == 1) {
+						_resumeDepth = 0;
+						if (_pos->skipChildren) return (HRESULT)eError::NotFound;
+					}
+					_FindInAcc(ref aDoc, 1);
+				} else switch (_Match(ref aDoc, 0)) {
 				case _eMatchResult::SkipChildren: return (HRESULT)eError::NotFound;
 				case _eMatchResult::Continue: _FindInAcc(ref aDoc, 1);
 				}
@@ -286,6 +326,15 @@ private:
 			if (aj.acc) return _FindInAcc(ref aj, 0) ? 0 : (HRESULT)eError::NotFound;
 		}
 
+		//flag Cache. Only inproc, because the cache is updated by an in-context WinEvent hook.
+		if (!!(_flags & eAF::Cache) && !isControl && !(_flags & eAF::UIA) && !(_flags2 & eAF2::NotInProc) && !_findDOCUMENT) {
+			if (AccCacheNode* root = AccCacheGet(w, !!(_flags & eAF::ClientArea), _context.maxcc)) {
+				bool stop = _FindInNode(root, 0);
+				AccCacheRelease();
+				return stop ? 0 : (HRESULT)eError::NotFound;
+			}
+		}
+
 		AccDtorIfElem0 aw;
 		HRESULT hr;
 		if (!!(_flags & eAF::UIA)) {
@@ -315,11 +364,15 @@ private:
 		return (HRESULT)eError::NotFound;
 	}
 
+	struct _PWorker;
+
 	//Returns true to stop.
-	bool _FindInAcc(const Cpp_Acc& aParent, int level) {
+	//pw - not null when called in a worker thread of parallel search.
+	bool _FindInAcc(const Cpp_Acc& aParent, int level, _PWorker* pw = null) {
+		if (_parallel && !pw) return _FindInAccParallel(aParent, level);
 		int startIndex = 0; bool exactIndex = false;
 
-		AccChildren c(ref _context, ref aParent, startIndex, exactIndex, !!(_flags & eAF::Reverse));
+		AccChildren c(ref pw ? pw->context : _context, ref aParent, startIndex, exactIndex, !!(_flags & eAF::Reverse));
 		//Printf(L"%i  %i", level, c.Count());
 		if (c.Count() == 0) {
 			//rejected: enable Chrome web AOs. Difficult to implement (lazy, etc). Let use prefix "web:".
@@ -329,31 +382,380 @@ private:
 			//}
 			return false;
 		}
-		for (;;) {
+		bool canSpawn = pw && c.Count() > 1;
+		for (int ordinal = 0; ; ordinal++) {
 			AccDtorIfElem0 aChild;
 			if (!c.GetNext(out aChild)) break;
 
-			switch (_Match(ref aChild, level, c.Count())) {
+			if (_pos) {
+				if (level < AccFindPosition::c_maxLevel) _curPath[level] = ordinal;
+				if (_resumeDepth > level) {
+					switch (_Resume(level, ordinal)) {
+					case 1: continue;
+					case 2:
+						aChild.misc.roleByte = aChild.GetRoleByte(); //AccChildren uses it
+						if (_FindInAcc(ref aChild, level + 1)) return true;
+						continue;
+					}
+				}
+			}
+
+			size_t iFound = 0;
+			if (pw) {
+				if (pw->pool.stop || pw->task->IsCancelled()) return true;
+				if (canSpawn && aChild.elem == 0 && pw->pool.IsHungry()) { //let an idle worker search this subtree
+					pw->Spawn(ref aChild, level, c.Count());
+					continue;
+				}
+				iFound = pw->task->entries.size();
+			}
+
+			switch (_Match(ref aChild, level, c.Count(), pw)) {
 			case _eMatchResult::Stop: return true;
 			case _eMatchResult::SkipChildren: continue;
 			}
 
-			if (_FindInAcc(ref aChild, level + 1)) return true;
+			if (pw && pw->task->entries.size() > iFound) { //_Match added aChild to entries. Search descendants, then set the end of its range.
+				if (_FindInAcc(ref aChild, level + 1, pw)) return true;
+				pw->task->entries[iFound].end = (int)pw->task->entries.size();
+			} else if (_FindInAcc(ref aChild, level + 1, pw)) return true;
 		} //now a.a is released if a.elem==0
+		if (_resumeDepth > level) _resumeDepth = 0; //the AO of the path does not exist now
+		return false;
+	}
+
+	//Called by _FindInAcc when continuing a stopped find-all search (AccFindPosition). Skips AO before the path, and goes into AO of the path without matching them again.
+	//Returns: 1 skip this AO, 2 search in its children (don't match it), 0 not resuming.
+	int _Resume(int level, int ordinal) {
+		int i = _pos->path[level];
+		if (ordinal < i) return 1;
+		if (ordinal > i) { _resumeDepth = 0; return 0; }
+		if (level == _resumeDepth - 1) { //the last found AO
+			_resumeDepth = 0;
+			if (_pos->skipChildren) return 1;
+		}
+		return 2;
+	}
+
+	//Like _FindInAcc, but gets children and their properties from the cache (flag Cache).
+	//Returns true to stop.
+	bool _FindInNode(AccCacheNode* parent, int level) {
+		int n = parent->Children(ref _context);
+		bool reverse = !!(_flags & eAF::Reverse);
+		for (int i = 0; i < n; i++) {
+			AccCacheNode* x = parent->children[reverse ? n - i - 1 : i];
+			if (_pos) {
+				if (level < AccFindPosition::c_maxLevel) _curPath[level] = i;
+				if (_resumeDepth > level) {
+					switch (_Resume(level, i)) {
+					case 1: continue;
+					case 2:
+						if (_FindInNode(x, level + 1)) return true;
+						continue;
+					}
+				}
+			}
+			AccDtorIfElem0 a(ref x->a); if (a.elem == 0) a.acc->AddRef(); //the node owns x->a; _Match can change a.misc
+			_cnode = x;
+			auto mr = _Match(ref a, level, n);
+			_cnode = null;
+			switch (mr) {
+			case _eMatchResult::Stop: return true;
+			case _eMatchResult::SkipChildren: continue;
+			}
+			if (_FindInNode(x, level + 1)) return true;
+		}
+		if (_resumeDepth > level) _resumeDepth = 0;
 		return false;
 	}
 
+#pragma region parallel
+	//Parallel search (flag Parallel).
+	//Worker threads search subtrees, and the main thread calls the callback for found AO in the same order as the single-thread search would.
+	//	The root task is the subtree of aParent. When some workers are idle, a worker gives children of the current AO to them as new tasks.
+	//	A task records found AO and new tasks in its entries, in preorder. When a task is completed, the main thread replays its entries.
+	//	When the callback says stop, cancels remaining work. When it says skip children, cancels tasks in that range.
+	//The main thread can be STA. Workers are MTA. AO are passed to/from the main thread with COM marshaling (UIA AO are copied instead).
+
+	static const int c_nPWorkers = 4; //the speed of latency-bound search grows with the number of threads, but so does the load of the target process
+
+	//Passes an AO to another thread.
+	struct _PAcc {
+		IStream* stream; //marshaled AO
+		IAccessible* acc; //or UIA AO copy
+
+		//In the source thread. Returns false if failed.
+		bool Put(const Cpp_Acc& a) {
+			if (!!(a.misc.flags & eAccMiscFlags::UIA) && !(a.misc.flags & eAccMiscFlags::InProc)) {
+				acc = AccUiaCopy(a.acc);
+				return true;
+			}
+			return 0 == CoMarshalInterThreadInterfaceInStream(IID_IAccessible, a.acc, &stream);
+		}
+
+		//In the destination thread. Returns null if failed.
+		IAccessible* Get() {
+			IAccessible* R = acc; acc = null;
+			if (stream) {
+				if (0 != CoGetInterfaceAndReleaseStream(stream, IID_IAccessible, (void**)&R)) R = null;
+				stream = null;
+			}
+			return R;
+		}
+
+		//If not used, releases the AO.
+		void Discard() {
+			if (acc) { acc->Release(); acc = null; }
+			if (stream) {
+				CoReleaseMarshalData(stream);
+				stream->Release(); stream = null;
+			}
+		}
+	};
+
+	struct _PTask;
+
+	//An AO found by a worker, or a subtree given to another worker.
+	struct _PEntry {
+		_PTask* task; //if not null, this entry is a subtree searched by another worker. Else a found AO.
+		_PAcc a;
+		long elem;
+		Cpp_Acc::MISC misc;
+		int end; //index of the entry after the entries found in descendants of this AO
+	};
+
+	//A subtree to search. The root task searches descendants of aParent. Other tasks search an AO and its descendants.
+	struct _PTask {
+		_PTask* parent = null; //the task that created this task. Null if the root task.
+		_PAcc aRoot = {}; //root task: aParent, passed from the main thread
+		IAccessible* acc = null; //other tasks: the AO, passed from another worker (same apartment). Owned.
+		Cpp_Acc::MISC misc = {};
+		int level = 0, nSiblings = 0;
+		std::vector<_PEntry> entries;
+		volatile long done = 0;
+		volatile bool cancel = false;
+
+		bool IsCancelled() const {
+			for (auto t = this; t; t = t->parent) if (t->cancel) return true;
+			return false;
+		}
+	};
+
+	//Owns tasks, gives them to workers, and notifies the main thread.
+	class _PPool {
+		SRWLOCK _lock;
+		CONDITION_VARIABLE _cv;
+		std::vector<std::unique_ptr<_PTask>> _tasks; //all tasks, in the order of creation
+		int _iNext; //the next task to run is _tasks[_iNext]
+		volatile int _nQueued, _nWaiting, _nRunning;
+	public:
+		HANDLE progress; //auto-reset event, set when a task is done
+		HANDLE exited; //manual-reset event, set when all workers returned
+		volatile long nWorkers; //running workers + 1 while the main thread adds them
+		volatile bool stop;
+
+		_PPool() {
+			InitializeSRWLock(&_lock);
+			InitializeConditionVariable(&_cv);
+			_iNext = _nQueued = _nWaiting = _nRunning = 0;
+			nWorkers = 1;
+			stop = false;
+			progress = CreateEventW(null, false, false, null);
+			exited = CreateEventW(null, true, false, null);
+		}
+
+		~_PPool() {
+			for (auto& t : _tasks) for (auto& e : t->entries) e.a.Discard();
+			CloseHandle(progress);
+			if (exited) CloseHandle(exited);
+		}
+
+		//Adds a task to the queue. Returns it.
+		_PTask* Add(_PTask* parent, const Cpp_Acc& a, int level, int nSiblings) {
+			auto t = new _PTask();
+			t->parent = parent;
+			t->misc = a.misc;
+			t->level = level; t->nSiblings = nSiblings;
+			if (parent) t->acc = a.acc; else if (!t->aRoot.Put(a)) { delete t; return null; }
+			AcquireSRWLockExclusive(&_lock);
+			_tasks.emplace_back(t);
+			_nQueued++;
+			ReleaseSRWLockExclusive(&_lock);
+			WakeConditionVariable(&_cv);
+			return t;
+		}
+
+		//Waits for a task. Returns null when there is no work (or stop) and other workers cannot add more.
+		_PTask* Get() {
+			_PTask* t = null;
+			AcquireSRWLockExclusive(&_lock);
+			_nWaiting++;
+			while (_nQueued == 0 && _nRunning > 0 && !stop) SleepConditionVariableSRW(&_cv, &_lock, INFINITE, 0);
+			_nWaiting--;
+			if (_nQueued > 0) {
+				t = _tasks[_iNext++].get();
+				_nQueued--; _nRunning++;
+			}
+			ReleaseSRWLockExclusive(&_lock);
+			if (!t) WakeAllConditionVariable(&_cv);
+			return t;
+		}
+
+		void Done(_PTask* t) {
+			InterlockedExchange(&t->done, 1);
+			AcquireSRWLockExclusive(&_lock);
+			bool noWork = --_nRunning == 0 && _nQueued == 0;
+			ReleaseSRWLockExclusive(&_lock);
+			if (noWork) WakeAllConditionVariable(&_cv);
+			SetEvent(progress);
+		}
+
+		//Returns true if some workers are waiting for tasks and there are not enough queued tasks. Not exact.
+		bool IsHungry() const { return _nWaiting > _nQueued; }
+
+		void Stop() {
+			AcquireSRWLockExclusive(&_lock);
+			stop = true;
+			ReleaseSRWLockExclusive(&_lock);
+			WakeAllConditionVariable(&_cv);
+		}
+	};
+
+	struct _PWorker {
+		AccFinder& finder;
+		_PPool& pool;
+		_PTask* task; //current
+		AccContext context;
+		std::vector<_Pred> preds; //a copy of finder._planner.preds. Each worker reorders and counts its own.
+		_Planner planner;
+
+		_PWorker(AccFinder& f, _PPool& p) : finder(f), pool(p), context(f._context.maxcc), preds(f._planner.preds, f._planner.preds + f._planner.nPreds) {
+			task = null;
+			planner = f._planner;
+			planner.preds = preds.data();
+		}
+
+		//Adds a found AO to the current task.
+		void AddFound(const Cpp_Acc& a) {
+			_PEntry e = {};
+			if (!e.a.Put(a)) { PRINTS(L"failed to marshal"); return; }
+			e.elem = a.elem; e.misc = a.misc;
+			e.end = (int)task->entries.size() + 1;
+			task->entries.push_back(e);
+		}
+
+		//Adds a new task for AO a. Takes a.acc.
+		void Spawn(ref AccRaw& a, int level, int nSiblings) {
+			_PEntry e = {};
+			e.task = pool.Add(task, a, level, nSiblings);
+			a.acc = null;
+			task->entries.push_back(e);
+		}
+
+		//Runs in a thread of the process default thread pool. Returns when there are no more tasks.
+		static void CALLBACK Callback(PTP_CALLBACK_INSTANCE inst, PVOID param) {
+			auto& w = *(_PWorker*)param;
+			CallbackMayRunLong(inst); //cross-process calls
+			HRESULT hrCo = CoInitializeEx(null, COINIT_MULTITHREADED); //fails if another pool callback left this thread STA
+			while (_PTask* t = w.pool.Get()) {
+				w.task = t;
+				if (w.pool.stop || t->IsCancelled()) {
+					t->aRoot.Discard();
+					if (t->acc) t->acc->Release();
+				} else w.finder._PRunTask(w);
+				w.pool.Done(t);
+			}
+			AccUiaThreadEnd();
+			if (SUCCEEDED(hrCo)) CoUninitialize();
+			if (0 == InterlockedDecrement(&w.pool.nWorkers)) SetEventWhenCallbackReturns(inst, w.pool.exited);
+		}
+	};
+
+	void _PRunTask(_PWorker& w) {
+		_PTask& t = *w.task;
+		AccDtorIfElem0 a(t.parent ? t.acc : t.aRoot.Get(), 0);
+		t.acc = null;
+		if (!a.acc) return;
+		a.misc = t.misc;
+		if (!t.parent) { //root task
+			_FindInAcc(ref a, t.level, &w);
+		} else if (_Match(ref a, t.level, t.nSiblings, &w) == _eMatchResult::Continue) {
+			bool found = !t.entries.empty(); //_Match added a
+			if (_FindInAcc(ref a, t.level + 1, &w)) return;
+			if (found) t.entries[0].end = (int)t.entries.size();
+		}
+	}
+
+	bool _FindInAccParallel(const Cpp_Acc& aParent, int level) {
+		_parallel = false; //this func is not reentrant, and the single-thread search is used if something fails
+		struct _Restore { bool& b; ~_Restore() { b = true; } } restore{ _parallel };
+		if (aParent.elem != 0 || !!(aParent.misc.flags & eAccMiscFlags::Java)) return _FindInAcc(aParent, level);
+
+		_PPool pool;
+		_PTask* root = pool.progress && pool.exited ? pool.Add(null, aParent, level, 0) : null;
+		if (!root) return _FindInAcc(aParent, level);
+
+		//Workers run in the process default thread pool. Not new threads, because this func can be called for each matching control (class/id).
+		std::unique_ptr<_PWorker> workers[c_nPWorkers]; int nWorkers = 0;
+		for (int i = 0; i < c_nPWorkers; i++) {
+			workers[i].reset(new _PWorker(*this, pool));
+			InterlockedIncrement(&pool.nWorkers);
+			if (TrySubmitThreadpoolCallback(_PWorker::Callback, workers[i].get(), null)) nWorkers++;
+			else InterlockedDecrement(&pool.nWorkers);
+		}
+		if (nWorkers == 0) { //unlikely
+			root->aRoot.Discard();
+			return _FindInAcc(aParent, level);
+		}
+
+		bool R = _PReplay(*root, pool);
+
+		pool.Stop();
+		if (0 != InterlockedDecrement(&pool.nWorkers)) {
+			DWORD k; CoWaitForMultipleHandles(0, INFINITE, 1, &pool.exited, &k); //the main thread may be STA. Pump COM calls while waiting.
+		}
+		return R;
+	}
+
+	//Calls the callback for AO found in task t and its subtasks. Returns true to stop.
+	bool _PReplay(_PTask& t, _PPool& pool) {
+		while (!t.done) { DWORD k; CoWaitForMultipleHandles(0, INFINITE, 1, &pool.progress, &k); }
+		for (int i = 0, n = (int)t.entries.size(); i < n; ) {
+			_PEntry& e = t.entries[i];
+			if (e.task) {
+				if (_PReplay(*e.task, pool)) return true;
+				i++;
+				continue;
+			}
+			Smart<IAccessible> acc; acc.Attach(e.a.Get());
+			if (!acc) { i++; continue; }
+			Cpp_Acc a(acc, e.elem); a.misc = e.misc;
+			switch ((*_callback)(a, 0, 0)) {
+			case eAccFindCallbackResult::Continue: i++; break;
+			case eAccFindCallbackResult::SkipChildren:
+				for (int j = i + 1; j < e.end; j++) if (t.entries[j].task) t.entries[j].task->cancel = true;
+				i = e.end;
+				break;
+			case eAccFindCallbackResult::StopFound: _found = true; [[fallthrough]];
+			default: return true;
+			}
+		}
+		return false;
+	}
+#pragma endregion
+
 	enum class _eMatchResult { Continue, Stop, SkipChildren };
 
-	_eMatchResult _Match(ref AccDtorIfElem0& a, int level, int nSiblings = 0) {
+	_eMatchResult _Match(ref AccDtorIfElem0& a, int level, int nSiblings = 0, _PWorker* pw = null) {
 		if (_findDOCUMENT && a.elem != 0) return _eMatchResult::SkipChildren;
 
 		bool skipChildren = a.elem != 0 || level >= _maxLevel;
 		bool hiddenToo = !!(_flags & eAF::HiddenToo);
-		_AccState state(ref a);
+		bool stopChunk = false; //_pos->maxFound AO found
+		_AccState state(ref a, _cnode);
 
 		_variant_t varRole;
-		BYTE role = a.GetRoleByteAndVariant(out varRole);
+		BYTE role = _cnode ? _cnode->Role(out varRole) : a.GetRoleByteAndVariant(out varRole);
 		a.misc.roleByte = role;
 		a.SetLevel(level);
 
@@ -418,48 +820,33 @@ private:
 
 			if (!!(_flags2 & eAF2::IsElem) && a.elem != _elem) goto gr;
 
-			if (mark > 0 && !_MatchRect(ref a)) mark = -1;
-
-			if (_name.Is() && mark >= 0 && !a.MatchStringProp(L"name", ref _name)) {
-				if (mark) mark = -1; else goto gr;
-			}
-
-			if (!hiddenToo) {
-				int iiv = state.IsInvisible();
-				switch (iiv) {
-				case 2: //INVISISBLE and OFFSCREEN
-					if (!_IsRoleToSkipIfInvisible(role)) break;
-					[[fallthrough]];
-				case 1: //only INVISIBLE
-					if (_IsRoleTopLevelClient(role, level)) break; //rare
-					return _eMatchResult::SkipChildren;
+			if (!mark) {
+				switch (_MatchPlanned(ref a, ref state, role, level, ref pw ? pw->planner : _planner)) {
+				case _ePlanResult::Failed: goto gr;
+				case _ePlanResult::Invisible: return _eMatchResult::SkipChildren;
 				}
+			} else { //compare in the fixed order, because sets mark = -1 when a property does not match
+				if (mark > 0 && !_MatchRect(ref a)) mark = -1;
 
-				//never mind: MSAA bug of child windows classnamed "Windows.UI.Input.InputSite.WindowClass": WINDOW has INVISIBLE, although descendants are visible.
-				//	It breaks MSAA in some Win11 apps, eg taskbar, terminal, paint. UIA OK.
-				//  Could apply a workaround here, but:
-				//	1. Also need a workaround in "elm from point" code. Difficult.
-				//	2. The tool auto-switches to UIA, and it's even faster.
-			}
-
-			if (!!(_stateYes | _stateNo) && mark >= 0) {
-				int k = state.State();
-				if ((k & _stateYes) != _stateYes || !!(k & _stateNo)) {
-					if (mark) mark = -1; else goto gr;
-				}
-			}
+				if (_name.Is() && mark >= 0 && !_MatchName(ref a)) mark = -1;
 
-			if (!mark && !_MatchRect(ref a))  goto gr;
+				if (!hiddenToo && _IsInvisibleToSkip(ref state, role, level)) return _eMatchResult::SkipChildren;
 
-			if (_propCount) {
-				bool hasHTML = false;
-				for (int i = 0; i < _propCount; i++) {
-					NameValue& p = _prop[i];
-					if (p.name[0] == '@') hasHTML = true;
-					else if (!a.MatchStringProp(p.name, ref p.value)) goto gr;
+				if (!!(_stateYes | _stateNo) && mark >= 0) {
+					int k = state.State();
+					if ((k & _stateYes) != _stateYes || !!(k & _stateNo)) mark = -1;
 				}
-				if (hasHTML) {
-					if (a.elem || !AccMatchHtmlAttributes(a.acc, _prop, _propCount)) goto gr;
+
+				if (_propCount) {
+					bool hasHTML = false;
+					for (int i = 0; i < _propCount; i++) {
+						NameValue& p = _prop[i];
+						if (p.name[0] == '@') hasHTML = true;
+						else if (!a.MatchStringProp(p.name, ref p.value)) goto gr;
+					}
+					if (hasHTML) {
+						if (a.elem || !AccMatchHtmlAttributes(a.acc, _prop, _propCount)) goto gr;
+					}
 				}
 			}
 
@@ -468,8 +855,15 @@ private:
 				_flags |= eAF::Marked_;
 			}
 
+			if (pw) { //parallel search. The main thread will call the callback.
+				pw->AddFound(a);
+				goto gr;
+			}
+
 			switch ((*_callback)(a, 0, 0)) {
-			case eAccFindCallbackResult::Continue: goto gr;
+			case eAccFindCallbackResult::Continue:
+				stopChunk = _pos && ++_pos->nFound >= _pos->maxFound && level < AccFindPosition::c_maxLevel;
+				goto gr;
 			case eAccFindCallbackResult::SkipChildren: return _eMatchResult::SkipChildren;
 			case eAccFindCallbackResult::StopFound: _found = true;
 				//case eAccFindCallbackResult::StopNotFound: break;
@@ -485,6 +879,13 @@ private:
 			if (!skipChildren && !hiddenToo && _IsRoleToSkipIfInvisible(role) && !_IsRoleTopLevelClient(role, level)) skipChildren = state.IsInvisible();
 		}
 
+		if (stopChunk) { //the next call will continue from here
+			_pos->depth = level + 1;
+			memcpy(_pos->path, _curPath, _pos->depth * sizeof(int));
+			_pos->skipChildren = skipChildren;
+			return _eMatchResult::Stop;
+		}
+
 		return skipChildren ? _eMatchResult::SkipChildren : _eMatchResult::Continue;
 	}
 
@@ -492,15 +893,21 @@ private:
 	//The first time calls get_accState. Later returns cached value.
 	class _AccState {
 		const AccRaw& _a;
+		AccCacheNode* _node;
 		long _state;
 	public:
-		_AccState(ref const AccRaw& a) : _a(a) { _state = -1; }
+		_AccState(ref const AccRaw& a, AccCacheNode* node = null) : _a(a), _node(node) { _state = -1; }
 
 		int State() {
-			if (_state == -1) _a.get_accState(out _state);
+			if (_state == -1) {
+				if (_node) _state = _node->State();
+				else _a.get_accState(out _state);
+			}
 			return _state;
 		}
 
+		bool Fetched() const { return _state != -1; }
+
 		//Returns: 1 INVISIBLE and not OFFSCREEN, 2 INVISIBLE and OFFSCREEN, 0 none.
 		int IsInvisible() {
 			switch (State() & (STATE_SYSTEM_INVISIBLE | STATE_SYSTEM_OFFSCREEN)) {
@@ -544,10 +951,154 @@ private:
 		return false;
 	}
 
+	//Returns true if the AO is invisible and its descendants must be skipped (without flag HiddenToo).
+	bool _IsInvisibleToSkip(ref _AccState& state, int role, int level) {
+		switch (state.IsInvisible()) {
+		case 2: //INVISISBLE and OFFSCREEN
+			if (!_IsRoleToSkipIfInvisible(role)) break;
+			[[fallthrough]];
+		case 1: //only INVISIBLE
+			if (_IsRoleTopLevelClient(role, level)) break; //rare
+			return true;
+		}
+		return false;
+
+		//never mind: MSAA bug of child windows classnamed "Windows.UI.Input.InputSite.WindowClass": WINDOW has INVISIBLE, although descendants are visible.
+		//	It breaks MSAA in some Win11 apps, eg taskbar, terminal, paint. UIA OK.
+		//  Could apply a workaround here, but:
+		//	1. Also need a workaround in "elm from point" code. Difficult.
+		//	2. The tool auto-switches to UIA, and it's even faster.
+	}
+
+#pragma region planner
+	//Predicate planner.
+	//_Match evaluates the predicates that need property fetches (name, state, rect, props) in the order of ascending cost/(1-passRate).
+	//	cost - average time of the fetch, measured for each provider type (MSAA inproc, MSAA not inproc, UIA, Java) and shared by all finders.
+	//	passRate - measured by this finder while searching.
+	//The order does not change results, because the predicates are a conjunction.
+	//	Only the rule "skip descendants of invisible AO" depends on the name. _MatchPlanned applies it like the fixed order would.
+
+	static volatile long s_cost[4][_nKinds]; //[provider][kind] average fetch time, in 1/16 of QueryPerformanceCounter units. 0 if not measured.
+
+	static int _PropKind(STR name) {
+		switch (name[0]) {
+		case 'v': return _kValue;
+		case 'd': return _kDesc;
+		case 'h': return _kHelp;
+		case 'a': return _kAction;
+		case 'k': return _kKey;
+		}
+		return name[4] == 'n' ? _kUiacn : _kUiaid;
+	}
+
+	//Called by SetParams.
+	void _InitPlanner() {
+		int n = _propCount + 3;
+		_Pred* a = _planner.preds = _arena.Alloc<_Pred>(n);
+		memset(a, 0, n * sizeof(_Pred));
+		n = 0;
+		if (_name.Is()) a[n++].kind = _kName;
+		if (!!(_stateYes | _stateNo)) a[n++].kind = _kState;
+		if (!!(_flags2 & eAF2::IsRect)) a[n++].kind = _kRect;
+		bool hasHTML = false;
+		for (int i = 0; i < _propCount; i++) {
+			if (_prop[i].name[0] == '@') hasHTML = true;
+			else { a[n].kind = (BYTE)_PropKind(_prop[i].name); a[n++].iProp = (short)i; }
+		}
+		if (hasHTML) a[n++].kind = _kHtml;
+		_planner.nPreds = n;
+		_planner.provider = -1;
+	}
+
+	int _Provider(const AccRaw& a) {
+		if (!!(a.misc.flags & eAccMiscFlags::UIA)) return 2;
+		if (!!(a.misc.flags & eAccMiscFlags::Java)) return 3;
+		return !!(_flags2 & eAF2::NotInProc) ? 1 : 0;
+	}
+
+	static double _Rank(const _Pred& p, int provider) {
+		static const BYTE c_priorCost[_nKinds] = { 16, 16, 16, 16, 24, 16, 16, 16, 16, 16, 64 };
+		static const float c_priorPass[_nKinds] = { .1f, .3f, .3f, .3f, .3f, .3f, .3f, .3f, .5f, .1f, .1f };
+		long cost = s_cost[provider][p.kind]; if (cost == 0) cost = c_priorCost[p.kind];
+		double pass = (p.nPass + 4 * c_priorPass[p.kind]) / (p.nEval + 4);
+		return cost / max(1 - pass, .01);
+	}
+
+	static void _Plan(ref _Planner& pl) {
+		_Pred* a = pl.preds;
+		for (int i = 1; i < pl.nPreds; i++) { //insertion sort; few elements
+			_Pred x = a[i]; double r = _Rank(x, pl.provider);
+			int j = i;
+			for (; j > 0 && _Rank(a[j - 1], pl.provider) > r; j--) a[j] = a[j - 1];
+			a[j] = x;
+		}
+	}
+
+	bool _EvalPred(ref AccDtorIfElem0& a, ref _AccState& state, ref _Pred& p, int provider) {
+		__int64 t0, t1; QueryPerformanceCounter((LARGE_INTEGER*)&t0);
+		bool ok, fetch = true;
+		switch (p.kind) {
+		case _kName: ok = _MatchName(ref a); break;
+		case _kState: {
+			fetch = !state.Fetched();
+			int k = state.State();
+			ok = (k & _stateYes) == _stateYes && !(k & _stateNo);
+		} break;
+		case _kRect: ok = _MatchRect(ref a); break;
+		case _kHtml: ok = a.elem == 0 && AccMatchHtmlAttributes(a.acc, _prop, _propCount); break;
+		default: ok = a.MatchStringProp(_prop[p.iProp].name, ref _prop[p.iProp].value); break;
+		}
+		if (fetch && !_cnode) { //update the average. Not thread-safe, but it's just statistics. Not when using the cache; it would make the averages too small.
+			QueryPerformanceCounter((LARGE_INTEGER*)&t1);
+			long x = (long)min((t1 - t0) * 16, 0x10000000), c = s_cost[provider][p.kind];
+			s_cost[provider][p.kind] = c ? c + (x - c) / 8 : max(x, 1);
+		}
+		p.nEval++; if (ok) p.nPass++;
+		return ok;
+	}
+
+	enum class _ePlanResult { Failed, Matched, Invisible };
+
+	_ePlanResult _MatchPlanned(ref AccDtorIfElem0& a, ref _AccState& state, int role, int level, ref _Planner& pl) {
+		bool hiddenToo = !!(_flags & eAF::HiddenToo);
+		int provider = _Provider(a);
+		if (pl.nPreds > 1 && ((pl.nCalls++ & 31) == 0 || provider != pl.provider)) {
+			pl.provider = provider;
+			_Plan(ref pl);
+		}
+
+		int nameResult = _name.Is() ? -1 : 1; //-1 not evaluated yet
+		for (int i = 0; i < pl.nPreds; i++) {
+			_Pred& p = pl.preds[i];
+			bool ok = _EvalPred(ref a, ref state, ref p, provider);
+			if (p.kind == _kName) nameResult = ok;
+			if (!ok) {
+				//The fixed order would be: name, then skip descendants if invisible, then other predicates.
+				if (nameResult == 0 || hiddenToo || !_IsInvisibleToSkip(ref state, role, level)) return _ePlanResult::Failed;
+				if (nameResult < 0) {
+					for (int j = i + 1; j < pl.nPreds; j++) if (pl.preds[j].kind == _kName) { nameResult = _EvalPred(ref a, ref state, ref pl.preds[j], provider); break; }
+				}
+				return nameResult ? _ePlanResult::Invisible : _ePlanResult::Failed;
+			}
+		}
+		if (!hiddenToo && _IsInvisibleToSkip(ref state, role, level)) return _ePlanResult::Invisible;
+		return _ePlanResult::Matched;
+	}
+#pragma endregion
+
+	bool _MatchName(ref AccDtorIfElem0& a) {
+		if (!_cnode) return a.MatchStringProp(L"name", ref _name);
+		BSTR s = _cnode->Name();
+		return _name.Match(s ? s : L"", SysStringLen(s));
+	}
+
 	bool _MatchRect(ref AccDtorIfElem0& a) {
 		if (!!(_flags2 & eAF2::IsRect)) {
 			long L, T, W, H;
-			if (0 != a.acc->accLocation(&L, &T, &W, &H, ao::VE(a.elem))) L = T = W = H = 0;
+			if (_cnode) {
+				auto r = _cnode->Rect();
+				L = r[0]; T = r[1]; W = r[2]; H = r[3];
+			} else if (0 != a.acc->accLocation(&L, &T, &W, &H, ao::VE(a.elem))) L = T = W = H = 0;
 
 			//note: _rect is raw AO rect, relative to the screen, not to the window/control/page. Its right/bottom actually are width/height.
 			//	It is useful when you want to find AO in the object tree when you already have its another IAccessible eg retrieved from point.
@@ -747,12 +1298,22 @@ private:
 	}
 };
 
-HRESULT AccFind(AccFindCallback& callback, HWND w, Cpp_Acc* aParent, const Cpp_AccFindParams& ap, out BSTR& errStr) {
+volatile long AccFinder::s_cost[4][AccFinder::_nKinds];
+
+HRESULT AccFind(AccFindCallback& callback, HWND w, Cpp_Acc* aParent, const Cpp_AccFindParams& ap, out BSTR& errStr, AccFindPosition* pos) {
 	AccFinder f(&errStr);
 	if (!f.SetParams(ref ap)) return (HRESULT)eError::InvalidParameter;
-	return f.Find(w, aParent, &callback);
+	return f.Find(w, aParent, &callback, pos);
 }
 
+#if _DEBUG
+//Used by Cpp_TestAccFinderAllocations.
+bool AccFinderTestSetParams(const Cpp_AccFindParams& ap, out BSTR& errStr) {
+	AccFinder f(&errStr);
+	return f.SetParams(ref ap);
+}
+#endif
+
 HRESULT AccEnableChrome2(HWND w, int i, HWND c) {
 	Smart<IAccessible> aw, aDoc;
 	HRESULT hr;
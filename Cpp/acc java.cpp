@@ -413,7 +413,8 @@ public:
 			state = STATE_SYSTEM_READONLY | STATE_SYSTEM_UNAVAILABLE | STATE_SYSTEM_INVISIBLE;
 			for(STR s = c.states_en_US; *s;) {
 				STR se = s; while(*se && *se != ',') se++;
-				switch(str::Switch(s, (int)(se - s), { L"busy",L"checked",L"collapsed",L"editable",L"enabled",L"expanded",L"focusable",L"focused",L"indeterminate",L"modal",L"multiselectable",L"pressed",L"resizable",L"selectable",L"selected",L"showing",L"visible" })) {
+				static constexpr str::SwitchTable s_states({ L"busy",L"checked",L"collapsed",L"editable",L"enabled",L"expanded",L"focusable",L"focused",L"indeterminate",L"modal",L"multiselectable",L"pressed",L"resizable",L"selectable",L"selected",L"showing",L"visible" });
+				switch(s_states.Switch(s, se - s)) {
 				case 1: state |= STATE_SYSTEM_BUSY; break;
 				case 2: state |= STATE_SYSTEM_CHECKED; break;
 				case 3: state |= STATE_SYSTEM_COLLAPSED; break;
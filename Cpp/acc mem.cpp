@@ -0,0 +1,633 @@
+#include "stdafx.h"
+#include "cpp.h"
+#include "acc.h"
+
+//In-memory accessible object trees. Used to test and benchmark AccFinder without live windows.
+//A tree can be recorded from a live AO (AccMemSave), eg a Chrome web page with 100000 AO, and later loaded from the file (AccMemLoad). Or generated (AccMemGenerate).
+//Like the UIA and Java wrappers, AO of a tree are IAccessible objects, therefore AccFinder, AccChildren etc work with them without changes.
+
+namespace accmem {
+	//File format: _FileHeader, then nodes in preorder.
+	//Node: _NodeHeader, then strings: custom role (if role is ROLE_CUSTOM), then strings for each strMask bit (c_props order).
+	//String: DWORD length, then characters (not '\0'-terminated).
+	struct _FileHeader {
+		DWORD magic, version, nNodes, reserved;
+	};
+	const DWORD c_fileMagic = 'TccA', c_version = 1; //"AccT"
+
+	struct _NodeHeader {
+		BYTE role; //0 if failed to get, ROLE_CUSTOM if VT_BSTR or not 1-ROLE_MAX
+		BYTE strMask; //1 << i for each non-empty string c_props[i]
+		WORD reserved;
+		DWORD state;
+		long L, T, W, H;
+		DWORD nChildren;
+	};
+
+	//Chars used by AccRaw::MatchStringProp etc. 'u' uiaid and 'U' uiacn are UIA props; get_accHelp gets them when varChild is VT_I1.
+	const char c_props[] = { 'n', 'v', 'd', 'h', 'a', 'k', 'u', 'U' };
+
+	static AccMemCounters s_counters;
+	static __int64 s_latency; //simulated latency of IAccessible calls, in QueryPerformanceCounter units. See AccMemSetLatency.
+
+	static void _Latency() {
+		if (s_latency == 0) return;
+		LARGE_INTEGER t0, t; QueryPerformanceCounter(&t0);
+		do { YieldProcessor(); QueryPerformanceCounter(&t); } while (t.QuadPart - t0.QuadPart < s_latency);
+	}
+
+	class MemTree {
+		struct _Node {
+			int parent, index; //parent node and index in its children. The root node has parent -1.
+			int firstChild, nChildren; //in _children
+			const BYTE* h; //_NodeHeader in _data, followed by strings
+		};
+
+		long _cRef;
+		BYTE* _data; size_t _size;
+		_Node* _nodes; int* _children;
+		int _nNodes;
+
+	public:
+		MemTree() noexcept { ZEROTHIS; _cRef = 1; }
+
+		~MemTree() {
+			free(_data); free(_nodes); free(_children);
+		}
+
+		void AddRef() { InterlockedIncrement(&_cRef); }
+
+		void Release() { if (!InterlockedDecrement(&_cRef)) delete this; }
+
+		//Takes ownership of data (malloc-ed), validates and indexes it.
+		bool Init(BYTE* data, size_t size) {
+			_data = data; _size = size;
+			if (size < sizeof(_FileHeader)) return false;
+			_FileHeader fh; memcpy(&fh, data, sizeof(fh));
+			if (fh.magic != c_fileMagic || fh.version != c_version || fh.nNodes == 0 || fh.nNodes > size / sizeof(_NodeHeader)) return false;
+			int n = _nNodes = (int)fh.nNodes;
+			_nodes = (_Node*)malloc(n * sizeof(_Node));
+			_children = (int*)malloc(n * sizeof(int));
+			if (!_nodes || !_children) return false;
+
+			//the children of a node are contiguous in _children. Reserve a range for them when the node is read; fill it when the children are read.
+			int nReserved = 0;
+			Buffer<int, 200> stack; int nStack = 0; //nodes that have unread children
+			const BYTE* p = data + sizeof(_FileHeader), * eof = data + size;
+			for (int i = 0; i < n; i++) {
+				if (eof - p < (ptrdiff_t)sizeof(_NodeHeader)) return false;
+				_NodeHeader h; memcpy(&h, p, sizeof(h));
+				_Node& x = _nodes[i];
+				x.h = p;
+				if (i == 0) { x.parent = -1; x.index = 0; } else {
+					if (nStack == 0) return false;
+					_Node& pa = _nodes[stack[nStack - 1]];
+					x.parent = stack[nStack - 1];
+					x.index = pa.nChildren++;
+					_children[pa.firstChild + x.index] = i;
+					if (x.index == (int)_NodeChildCount(pa) - 1) nStack--; //the last child of pa
+				}
+				if (h.nChildren > (DWORD)(n - 1 - nReserved)) return false;
+				x.firstChild = nReserved; x.nChildren = 0;
+				nReserved += h.nChildren;
+				if (h.nChildren) {
+					stack.Realloc(nStack + 1)[nStack++] = i;
+				}
+
+				p += sizeof(_NodeHeader);
+				for (int k = _StringCount(h); k > 0; k--) {
+					DWORD len;
+					if (eof - p < 4) return false;
+					memcpy(&len, p, 4);
+					if ((size_t)(eof - p - 4) / 2 < len) return false;
+					p += 4 + len * 2;
+				}
+			}
+			return nStack == 0 && nReserved == n - 1;
+		}
+
+		int Count() const { return _nNodes; }
+
+		int Parent(int i) const { return _nodes[i].parent; }
+
+		int ChildCount(int i) const { return _nodes[i].nChildren; }
+
+		//Returns the child node at index, or -1 if index is invalid.
+		int Child(int i, int index) const {
+			auto& x = _nodes[i];
+			return (DWORD)index < (DWORD)x.nChildren ? _children[x.firstChild + index] : -1;
+		}
+
+		//Returns the next (next true) or previous sibling node, or -1.
+		int Sibling(int i, bool next) const {
+			auto& x = _nodes[i];
+			return x.parent < 0 ? -1 : Child(x.parent, x.index + (next ? 1 : -1));
+		}
+
+		_NodeHeader Header(int i) const {
+			_NodeHeader h; memcpy(&h, _nodes[i].h, sizeof(h));
+			return h;
+		}
+
+		//Gets string prop (see c_props) or custom role (prop 'r').
+		//Returns false if it's empty.
+		bool String(int i, char prop, out STR& s, out DWORD& len) const {
+			_NodeHeader h = Header(i);
+			int k = -1; //index of the string in the node
+			if (prop == 'r') {
+				if (h.role != ROLE_CUSTOM) return false;
+				k = 0;
+			} else {
+				int bit = 0;
+				while (c_props[bit] != prop) if (++bit == _countof(c_props)) return false;
+				if (!(h.strMask & (1 << bit))) return false;
+				k = h.role == ROLE_CUSTOM;
+				for (int j = 0; j < bit; j++) if (h.strMask & (1 << j)) k++;
+			}
+			const BYTE* p = _nodes[i].h + sizeof(_NodeHeader);
+			for (;;) {
+				memcpy(&len, p, 4);
+				if (k-- == 0) break;
+				p += 4 + len * 2;
+			}
+			s = (STR)(p + 4);
+			return true;
+		}
+
+	private:
+		DWORD _NodeChildCount(const _Node& x) const {
+			_NodeHeader h; memcpy(&h, x.h, sizeof(h));
+			return h.nChildren;
+		}
+
+		static int _StringCount(const _NodeHeader& h) {
+			int n = h.role == ROLE_CUSTOM;
+			for (int m = h.strMask; m; m &= m - 1) n++;
+			return n;
+		}
+	};
+
+	//The tree is immutable, therefore these objects can be used in any thread (the free-threaded marshaler), like UIA elements. For parallel search benchmarks.
+	//	Only IEnumVARIANT isn't thread-safe; AccFinder does not use an object in multiple threads simultaneously.
+	class MemAccessible : public IAccessible, IEnumVARIANT {
+		long _cRef;
+		int _next; //IEnumVARIANT
+		MemTree* _t;
+		int _i; //node
+		IUnknown* volatile _ftm; //free-threaded marshaler, created when need
+
+	public:
+		MemAccessible(MemTree* t, int i) {
+			_cRef = 1;
+			_next = 0;
+			_t = t; _t->AddRef();
+			_i = i;
+			_ftm = null;
+			InterlockedIncrement64(&s_counters.nObjects);
+		}
+
+		~MemAccessible() {
+			if (_ftm) _ftm->Release();
+			_t->Release();
+		}
+
+#pragma region IUnknown, IDispatch
+		STDMETHODIMP QueryInterface(REFIID iid, void** ppv) {
+			if (iid == IID_IAccessible || iid == IID_IDispatch || iid == IID_IUnknown) {
+				InterlockedIncrement(&_cRef);
+				*ppv = this;
+				return 0;
+			} else if (iid == IID_IEnumVARIANT) {
+				InterlockedIncrement(&_cRef);
+				*ppv = (IEnumVARIANT*)this;
+				return 0;
+			} else if (iid == IID_IMarshal) {
+				if (!_ftm) {
+					IUnknown* u = null;
+					if (0 == CoCreateFreeThreadedMarshaler((IAccessible*)this, &u) && InterlockedCompareExchangePointer((void* volatile*)&_ftm, u, null) != null) u->Release();
+				}
+				if (_ftm) return _ftm->QueryInterface(iid, ppv);
+			}
+			*ppv = 0;
+			return E_NOINTERFACE;
+		}
+
+		STDMETHODIMP_(ULONG) AddRef() {
+			return InterlockedIncrement(&_cRef);
+		}
+
+		STDMETHODIMP_(ULONG) Release() {
+			long ret = InterlockedDecrement(&_cRef);
+			if (!ret) delete this;
+			return ret;
+		}
+
+		STDMETHODIMP GetTypeInfoCount(UINT* pctinfo) { return E_NOTIMPL; }
+
+		STDMETHODIMP GetTypeInfo(UINT iTInfo, LCID lcid, ITypeInfo** ppTInfo) { return E_NOTIMPL; }
+
+		STDMETHODIMP GetIDsOfNames(REFIID riid, LPOLESTR* rgszNames, UINT cNames, LCID lcid, __RPC__out_ecount_full(cNames) DISPID* rgDispId) { return E_NOTIMPL; }
+
+		STDMETHODIMP Invoke(DISPID dispIdMember, REFIID riid, LCID lcid, WORD wFlags, DISPPARAMS* pDispParams, VARIANT* pVarResult, EXCEPINFO* pExcepInfo, UINT* puArgErr) { return E_NOTIMPL; }
+#pragma endregion
+
+#pragma region IEnumVARIANT
+		STDMETHODIMP Next(ULONG celt, VARIANT* rgVar, ULONG* pCeltFetched) {
+			if (pCeltFetched) *pCeltFetched = 0;
+			_Latency();
+			int cc = _t->ChildCount(_i);
+			for (ULONG i = 0; i < celt; i++, _next++) {
+				if (_next >= cc) return 1;
+				rgVar[i].pdispVal = new MemAccessible(_t, _t->Child(_i, _next));
+				rgVar[i].vt = VT_DISPATCH;
+				if (pCeltFetched) (*pCeltFetched)++;
+			}
+			return 0;
+		}
+		STDMETHODIMP Skip(ULONG celt) {
+			_next += celt;
+			return _next <= _t->ChildCount(_i) ? 0 : 1;
+		}
+		STDMETHODIMP Reset(void) {
+			_next = 0;
+			return 0;
+		}
+		STDMETHODIMP Clone(IEnumVARIANT** ppEnum) {
+			return E_NOTIMPL;
+		}
+#pragma endregion
+
+#pragma region IAccessible
+		STDMETHODIMP get_accParent(IDispatch** ppdispParent) {
+			int p = _t->Parent(_i);
+			*ppdispParent = p < 0 ? null : new MemAccessible(_t, p);
+			return p < 0 ? 1 : 0;
+		}
+
+		STDMETHODIMP get_accChildCount(long* pcountChildren) {
+			InterlockedIncrement64(&s_counters.nChildren);
+			_Latency();
+			*pcountChildren = _t->ChildCount(_i);
+			return 0;
+		}
+
+		STDMETHODIMP get_accChild(VARIANT varChild, IDispatch** ppdispChild) {
+			*ppdispChild = null;
+			if (varChild.vt != VT_I4) return E_INVALIDARG;
+			int c = _t->Child(_i, varChild.lVal - 1);
+			if (c < 0) return E_INVALIDARG;
+			*ppdispChild = new MemAccessible(_t, c);
+			return 0;
+		}
+
+		STDMETHODIMP get_accName(VARIANT varChild, out BSTR* pszName) {
+			return _GetString(varChild, 'n', pszName);
+		}
+
+		STDMETHODIMP get_accValue(VARIANT varChild, out BSTR* pszValue) {
+			return _GetString(varChild, 'v', pszValue);
+		}
+
+		STDMETHODIMP get_accDescription(VARIANT varChild, out BSTR* pszDescription) {
+			return _GetString(varChild, 'd', pszDescription);
+		}
+
+		STDMETHODIMP get_accRole(VARIANT varChild, out VARIANT* pvarRole) {
+			if (_InvalidVarChildParam(ref varChild)) return E_INVALIDARG;
+			InterlockedIncrement64(&s_counters.nRole);
+			_Latency();
+			BYTE role = _t->Header(_i).role;
+			if (role == 0) return E_FAIL;
+			if (role == ROLE_CUSTOM) {
+				STR s; DWORD len; _t->String(_i, 'r', out s, out len);
+				pvarRole->vt = VT_BSTR;
+				pvarRole->bstrVal = SysAllocStringLen(s, len);
+			} else {
+				pvarRole->vt = VT_I4;
+				pvarRole->lVal = role;
+			}
+			return 0;
+		}
+
+		STDMETHODIMP get_accState(VARIANT varChild, out VARIANT* pvarState) {
+			if (_InvalidVarChildParam(ref varChild)) return E_INVALIDARG;
+			InterlockedIncrement64(&s_counters.nState);
+			_Latency();
+			pvarState->vt = VT_I4;
+			pvarState->lVal = _t->Header(_i).state;
+			return 0;
+		}
+
+		STDMETHODIMP get_accHelp(VARIANT varChild, out BSTR* pszHelp) {
+			if (varChild.vt == VT_I1) { //prop uiaid, uiacn
+				ao::VE ve;
+				return _GetString(ve, varChild.cVal == 'U' ? 'U' : 'u', pszHelp);
+			}
+			return _GetString(varChild, 'h', pszHelp);
+		}
+
+		STDMETHODIMP get_accHelpTopic(BSTR* pszHelpFile, VARIANT varChild, long* pidTopic) {
+			return E_NOTIMPL;
+		}
+
+		STDMETHODIMP get_accKeyboardShortcut(VARIANT varChild, out BSTR* pszKeyboardShortcut) {
+			return _GetString(varChild, 'k', pszKeyboardShortcut);
+		}
+
+		STDMETHODIMP get_accFocus(out VARIANT* pvarChild) {
+			return E_NOTIMPL;
+		}
+
+		STDMETHODIMP get_accSelection(out VARIANT* pvarChildren) {
+			return E_NOTIMPL;
+		}
+
+		STDMETHODIMP get_accDefaultAction(VARIANT varChild, out BSTR* pszDefaultAction) {
+			return _GetString(varChild, 'a', pszDefaultAction);
+		}
+
+		STDMETHODIMP accSelect(long flagsSelect, VARIANT varChild) {
+			return E_NOTIMPL;
+		}
+
+		STDMETHODIMP accLocation(out long* pxLeft, out long* pyTop, out long* pcxWidth, out long* pcyHeight, VARIANT varChild) {
+			if (_InvalidVarChildParam(ref varChild)) return E_INVALIDARG;
+			InterlockedIncrement64(&s_counters.nRect);
+			_Latency();
+			auto h = _t->Header(_i);
+			*pxLeft = h.L; *pyTop = h.T; *pcxWidth = h.W; *pcyHeight = h.H;
+			return 0;
+		}
+
+		STDMETHODIMP accNavigate(long navDir, VARIANT varStart, out VARIANT* pvarEndUpAt) {
+			//WindowFromAccessibleObject at first calls this with an undocumented navDir 10. These AO don't have a window.
+			if (navDir < NAVDIR_UP || navDir > NAVDIR_LASTCHILD) return E_INVALIDARG;
+			if (_InvalidVarChildParam(ref varStart)) return E_INVALIDARG;
+			int i = -1;
+			switch (navDir) {
+			case NAVDIR_NEXT: i = _t->Sibling(_i, true); break;
+			case NAVDIR_PREVIOUS: i = _t->Sibling(_i, false); break;
+			case NAVDIR_FIRSTCHILD: i = _t->Child(_i, 0); break;
+			case NAVDIR_LASTCHILD: i = _t->Child(_i, _t->ChildCount(_i) - 1); break;
+			}
+			if (i < 0) return 1;
+			pvarEndUpAt->pdispVal = new MemAccessible(_t, i);
+			pvarEndUpAt->vt = VT_DISPATCH;
+			return 0;
+		}
+
+		STDMETHODIMP accHitTest(long xLeft, long yTop, out VARIANT* pvarChild) {
+			return E_NOTIMPL;
+		}
+
+		STDMETHODIMP accDoDefaultAction(VARIANT varChild) {
+			return E_NOTIMPL;
+		}
+
+		STDMETHODIMP put_accName(VARIANT varChild, BSTR szName) {
+			return E_NOTIMPL;
+		}
+
+		STDMETHODIMP put_accValue(VARIANT varChild, BSTR szValue) {
+			return E_NOTIMPL;
+		}
+#pragma endregion
+
+	private:
+		bool _InvalidVarChildParam(const VARIANT& v) {
+			if (v.vt == 0) return false; //forgive
+			return v.vt != VT_I4 || v.lVal != 0;
+		}
+
+		HRESULT _GetString(const VARIANT& varChild, char prop, out BSTR* R) {
+			*R = null;
+			if (_InvalidVarChildParam(ref varChild)) return E_INVALIDARG;
+			InterlockedIncrement64(prop == 'n' ? &s_counters.nName : &s_counters.nProps);
+			_Latency();
+			STR s; DWORD len;
+			if (!_t->String(_i, prop, out s, out len)) return 1; //like most AO when the prop is empty
+			*R = SysAllocStringLen(s, len);
+			return 0;
+		}
+	};
+
+	//Writes nodes in the file format.
+	class _Writer {
+		std::vector<BYTE> _b;
+		DWORD _nNodes;
+	public:
+		_Writer() {
+			_nNodes = 0;
+			_b.resize(sizeof(_FileHeader));
+		}
+
+		//Appends a node. Returns its offset, for SetChildCount.
+		size_t AddNode(const _NodeHeader& h) {
+			_nNodes++;
+			size_t r = _b.size();
+			_Append(&h, sizeof(h));
+			return r;
+		}
+
+		//Appends a string of the last node. Call in the file format order.
+		void AddString(STR s, DWORD len) {
+			_Append(&len, 4);
+			_Append(s, len * 2);
+		}
+
+		void SetChildCount(size_t node, DWORD n) {
+			memcpy(_b.data() + node + offsetof(_NodeHeader, nChildren), &n, 4);
+		}
+
+		//Sets the file header. Returns the data.
+		std::vector<BYTE>& Finish() {
+			_FileHeader fh = { c_fileMagic, c_version, _nNodes };
+			memcpy(_b.data(), &fh, sizeof(fh));
+			return _b;
+		}
+
+	private:
+		void _Append(const void* p, size_t n) {
+			auto k = _b.size();
+			_b.resize(k + n);
+			memcpy(_b.data() + k, p, n);
+		}
+	};
+
+	//Records a live AO and its descendants.
+	class _Recorder {
+		AccContext _context;
+		_Writer& _w;
+		int _maxLevel;
+	public:
+		_Recorder(_Writer& w, int maxLevel) : _w(w) { _maxLevel = maxLevel; }
+
+		void Add(const AccRaw& a, int level) {
+			_NodeHeader h = {};
+			_variant_t vRole;
+			int roleInt;
+			bool customRole = false;
+			if (0 == ao::GetRoleIntAndVariant(a.acc, a.elem, out roleInt, out vRole)) {
+				if (roleInt > 0 && roleInt <= ROLE_MAX) h.role = (BYTE)roleInt;
+				else { h.role = ROLE_CUSTOM; customRole = true; }
+			}
+			long state; a.get_accState(out state); h.state = state;
+			if (0 != a.acc->accLocation(&h.L, &h.T, &h.W, &h.H, ao::VE(a.elem))) h.L = h.T = h.W = h.H = 0;
+
+			Bstr s[_countof(c_props)];
+			bool isUIA = !!(a.misc.flags & eAccMiscFlags::UIA);
+			for (int i = 0; i < _countof(c_props); i++) {
+				ao::VE ve(a.elem);
+				HRESULT hr = 1;
+				switch (c_props[i]) {
+				case 'n': hr = a.acc->get_accName(ve, &s[i]); break;
+				case 'v': hr = a.acc->get_accValue(ve, &s[i]); break;
+				case 'd': hr = a.acc->get_accDescription(ve, &s[i]); break;
+				case 'h': hr = a.acc->get_accHelp(ve, &s[i]); break;
+				case 'a': hr = a.acc->get_accDefaultAction(ve, &s[i]); break;
+				case 'k': hr = a.acc->get_accKeyboardShortcut(ve, &s[i]); break;
+				default: //uiaid, uiacn
+					if (!isUIA) continue;
+					ve.vt = VT_I1; ve.cVal = c_props[i];
+					hr = a.acc->get_accHelp(ve, &s[i]);
+				}
+				if (hr == 0 && s[i].Length() > 0) h.strMask |= 1 << i;
+			}
+
+			size_t node = _w.AddNode(h);
+			if (customRole) {
+				STR rs = ao::RoleToString(ref vRole);
+				_w.AddString(rs, (DWORD)wcslen(rs));
+			}
+			for (int i = 0; i < _countof(c_props); i++) if (h.strMask & (1 << i)) _w.AddString(s[i], s[i].Length());
+
+			if (a.elem != 0 || level >= _maxLevel) return;
+			DWORD n = 0;
+			AccRaw ap(a); ap.misc.roleByte = h.role; //like AccFinder, for _RemoveInvisibleNonclient
+			AccChildren c(ref _context, ref ap);
+			for (;;) {
+				AccDtorIfElem0 aChild;
+				if (!c.GetNext(out aChild)) break;
+				Add(aChild, level + 1);
+				n++;
+			}
+			_w.SetChildCount(node, n);
+		}
+	};
+
+	HRESULT FromData(BYTE* data, size_t size, out IAccessible** iacc) {
+		*iacc = null;
+		auto t = new MemTree();
+		if (!t->Init(data, size)) { t->Release(); return E_INVALIDARG; }
+		*iacc = new MemAccessible(t, 0);
+		t->Release();
+		return 0;
+	}
+} //namespace accmem
+
+HRESULT AccMemLoad(STR file, out IAccessible** iacc) {
+	*iacc = null;
+	HANDLE hf = CreateFileW(file, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, null, OPEN_EXISTING, 0, null);
+	if (hf == INVALID_HANDLE_VALUE) return HRESULT_FROM_WIN32(GetLastError());
+	HRESULT hr = E_INVALIDARG;
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(hf, &size) && size.QuadPart > 0 && size.QuadPart < 0x40000000) {
+		DWORD n = (DWORD)size.QuadPart, nRead = 0;
+		auto data = (BYTE*)malloc(n);
+		if (data == null) hr = E_OUTOFMEMORY;
+		else if (!ReadFile(hf, data, n, &nRead, null) || nRead != n) { hr = HRESULT_FROM_WIN32(GetLastError()); free(data); }
+		else hr = accmem::FromData(data, n, iacc);
+	}
+	CloseHandle(hf);
+	return hr;
+}
+
+HRESULT AccMemFromData(const BYTE* data, size_t size, out IAccessible** iacc) {
+	auto copy = (BYTE*)malloc(size);
+	if (copy == null) { *iacc = null; return E_OUTOFMEMORY; }
+	memcpy(copy, data, size);
+	return accmem::FromData(copy, size, iacc);
+}
+
+HRESULT AccMemSave(const Cpp_Acc& a, STR file, int maxLevel, out int* nNodes) {
+	accmem::_Writer w;
+	accmem::_Recorder r(w, maxLevel);
+	r.Add(AccRaw(a), 0);
+	auto& b = w.Finish();
+	if (nNodes) { accmem::_FileHeader fh; memcpy(&fh, b.data(), sizeof(fh)); *nNodes = (int)fh.nNodes; }
+
+	HANDLE hf = CreateFileW(file, GENERIC_WRITE, 0, null, CREATE_ALWAYS, 0, null);
+	if (hf == INVALID_HANDLE_VALUE) return HRESULT_FROM_WIN32(GetLastError());
+	DWORD nWritten = 0;
+	HRESULT hr = WriteFile(hf, b.data(), (DWORD)b.size(), &nWritten, null) && nWritten == b.size() ? 0 : HRESULT_FROM_WIN32(GetLastError());
+	CloseHandle(hf);
+	return hr;
+}
+
+HRESULT AccMemGenerate(int nNodes, out IAccessible** iacc) {
+	//Shape like typical web pages and other big trees: ~50% of AO have 0 children, ~20% 1, others 2-10; rarely 100.
+	//At first decide child counts in breadth-first order, then write nodes in preorder.
+	if (nNodes < 1) { *iacc = null; return E_INVALIDARG; }
+	std::vector<int> cc(nNodes);
+	UINT seed = 1;
+	auto rnd = [&seed](UINT n) { seed = seed * 1103515245 + 12345; return (seed >> 16) % n; };
+	for (int i = 0, next = 1; i < nNodes && next < nNodes; i++) {
+		UINT r = rnd(100), n = r < 50 ? 0 : r < 70 ? 1 : r < 99 ? 2 + rnd(9) : 100;
+		if (n == 0 && next == i + 1) n = 1; //else the tree would end early
+		n = min(n, (UINT)(nNodes - next));
+		cc[i] = n; next += n;
+	}
+
+	static const BYTE roles[] = { ROLE_SYSTEM_GROUPING, ROLE_SYSTEM_STATICTEXT, ROLE_SYSTEM_STATICTEXT, ROLE_SYSTEM_LINK, ROLE_SYSTEM_PUSHBUTTON, ROLE_SYSTEM_LIST, ROLE_SYSTEM_LISTITEM, ROLE_SYSTEM_TEXT, ROLE_SYSTEM_GRAPHIC, ROLE_SYSTEM_CELL, ROLE_SYSTEM_ROW, ROLE_SYSTEM_TABLE, ROLE_CUSTOM };
+	accmem::_Writer w;
+	//children of node i are next[i]...; bfs index -> preorder by recursion on bfs indices
+	std::vector<int> first(nNodes);
+	for (int i = 0, next = 1; i < nNodes; i++) { first[i] = next; next += cc[i]; }
+	std::function<void(int, int)> add = [&](int i, int level) {
+		accmem::_NodeHeader h = {};
+		h.role = i == 0 ? ROLE_SYSTEM_DOCUMENT : roles[rnd(_countof(roles))];
+		h.state = STATE_SYSTEM_FOCUSABLE | (rnd(50) == 0 ? STATE_SYSTEM_INVISIBLE : 0) | (rnd(10) == 0 ? STATE_SYSTEM_OFFSCREEN : 0);
+		h.L = rnd(1000); h.T = i; h.W = 20 + rnd(500); h.H = 20;
+		h.nChildren = cc[i];
+		WCHAR name[40]; int nameLen = 0;
+		if (h.role != ROLE_SYSTEM_GROUPING && h.role != ROLE_SYSTEM_ROW) {
+			nameLen = swprintf_s(name, L"Item %i level %i", i, level);
+			h.strMask |= 1;
+		}
+		if (h.role == ROLE_SYSTEM_LINK || i == 0) h.strMask |= 2; //value: URL
+		if (h.role == ROLE_SYSTEM_LINK || h.role == ROLE_SYSTEM_PUSHBUTTON) h.strMask |= 16; //default action
+		w.AddNode(h);
+		if (h.role == ROLE_CUSTOM) w.AddString(L"region", 6);
+		if (h.strMask & 1) w.AddString(name, nameLen);
+		if (h.strMask & 2) { WCHAR url[40]; w.AddString(url, swprintf_s(url, L"https://www.example.com/%i", i)); }
+		if (h.strMask & 16) w.AddString(L"Click", 5);
+		for (int j = 0; j < cc[i]; j++) add(first[i] + j, level + 1);
+	};
+	add(0, 0);
+	auto& b = w.Finish();
+	return AccMemFromData(b.data(), b.size(), iacc);
+}
+
+void AccMemSetLatency(int microseconds) {
+	LARGE_INTEGER f; QueryPerformanceFrequency(&f);
+	accmem::s_latency = f.QuadPart * microseconds / 1000000;
+}
+
+void AccMemGetCounters(out AccMemCounters& c, bool reset) {
+	c = accmem::s_counters;
+	if (reset) accmem::s_counters = {};
+}
+
+namespace outproc {
+	//Records AO a and its descendants (max maxLevel levels) to a file that can be loaded with Cpp_AccMemLoad.
+	//For testing and benchmarking the AO finder with recorded trees.
+	EXPORT HRESULT Cpp_AccMemSave(Cpp_Acc a, STR file, int maxLevel, out int& nNodes) {
+		return AccMemSave(a, file, maxLevel, &nNodes);
+	}
+
+	//Loads an AO tree recorded with Cpp_AccMemSave. aResult receives the root AO.
+	EXPORT HRESULT Cpp_AccMemLoad(STR file, out Cpp_Acc& aResult) {
+		aResult.Zero();
+		return AccMemLoad(file, &aResult.acc);
+	}
+}
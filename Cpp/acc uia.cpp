@@ -89,6 +89,12 @@ namespace uia {
 			InterlockedDecrement(&s_uiaWrapperCount);
 		}
 
+		//Returns a new wrapper of the same element. Used to pass the AO to another thread: UIA elements are agile, but the wrapper isn't thread-safe (_next, _children).
+		UIAccessible* Copy() {
+			_ae->AddRef();
+			return new UIAccessible(_ae);
+		}
+
 #pragma region IUnknown, IDispatch
 		STDMETHODIMP QueryInterface(REFIID iid, void** ppv) {
 			//PrintGuid(iid);
@@ -833,6 +839,20 @@ HRESULT AccUiaFocused(out IAccessible** iacc) {
 
 IUIAutomation* UIA() { return uia::UIA(); }
 
+//Returns a new UIA wrapper of the same element as iacc. Use it instead of marshaling when passing the AO to another thread.
+//iacc must be a UIA AO retrieved not inproc (then it is a wrapper created in this process).
+IAccessible* AccUiaCopy(IAccessible* iacc) {
+	return static_cast<uia::UIAccessible*>(iacc)->Copy();
+}
+
+//Releases UIA objects cached for this thread. Call before CoUninitialize in temporary threads that used UIA AO.
+void AccUiaThreadEnd() {
+	auto& tv = uia::t_var;
+	tv.rawWalk.Release();
+	tv.rawCond.Release();
+	tv.uia.Release();
+}
+
 //HRESULT AccUiaFromMSAA(IAccessible* msaa, int elem, out IAccessible** iacc)
 //{
 //	return uia::AccFromMSAA(msaa, elem, iacc);
@@ -657,4 +657,57 @@ HRESULT AccUiaFromWindow(HWND w, out IAccessible** iacc);
 HRESULT AccUiaFromPoint(POINT p, out IAccessible** iacc);
 HRESULT AccUiaFocused(out IAccessible** iacc);
 IUIAutomation* UIA();
+IAccessible* AccUiaCopy(IAccessible* iacc);
+void AccUiaThreadEnd();
+
+//Counters of IAccessible calls of AO created by AccMemLoad etc. For benchmarks.
+struct AccMemCounters {
+	__int64 nObjects; //created AO
+	__int64 nChildren; //get_accChildCount
+	__int64 nRole, nState, nRect, nName; //get_accRole (each visited AO), get_accState, accLocation, get_accName
+	__int64 nProps; //other string props
+};
+
+//In-memory AO trees. See "acc mem.cpp".
+HRESULT AccMemLoad(STR file, out IAccessible** iacc);
+HRESULT AccMemFromData(const BYTE* data, size_t size, out IAccessible** iacc);
+HRESULT AccMemSave(const Cpp_Acc& a, STR file, int maxLevel = 1000, out int* nNodes = null);
+HRESULT AccMemGenerate(int nNodes, out IAccessible** iacc);
+//Sets simulated latency of each IAccessible call of AO created by AccMemLoad etc, like of cross-process calls. Busy-waits.
+void AccMemSetLatency(int microseconds);
+void AccMemGetCounters(out AccMemCounters& c, bool reset);
+
+//A node of the cached AO tree of a window. Used by AccFinder with flag eAF::Cache. See "acc cache.cpp".
+//The getters return cached data. Get it from the AO if not cached yet or if the AO changed since.
+struct AccCacheNode {
+	enum { HasChildren = 1, HasRole = 2, HasName = 4, HasState = 8, HasRect = 16 };
+
+	AccRaw a; //acc is AddRef-ed if elem is 0, else it is the parent's acc
+	IUnknown* id; //COM identity of acc. Not AddRef-ed. Used to find the node of an AO.
+	AccCacheNode* parent;
+	std::vector<AccCacheNode*> children;
+	_variant_t varRole;
+	Bstr name;
+	long state;
+	long rect[4]; //L T W H
+	BYTE has; //Has flags of valid data
+	bool foreign; //WINDOW of another thread. Data in its subtree is marked dirty in each find.
+
+	AccCacheNode(AccCacheNode* parent_, ref const AccRaw& a_, IUnknown* id_);
+	~AccCacheNode();
+
+	int Children(ref AccContext& context);
+	BYTE Role(out _variant_t& vr);
+	BSTR Name();
+	long State();
+	const long* Rect();
+};
+
+//Gets the root node of the cached AO tree of window w (object OBJID_CLIENT or OBJID_WINDOW). Creates the cache if need.
+//Returns null if w is not of this thread, if the caches of this thread are in use (reentrant call) or if fails.
+//If returns not null, finally must call AccCacheRelease.
+AccCacheNode* AccCacheGet(HWND w, bool inCLIENT, int maxcc);
+void AccCacheRelease();
+//Frees all caches of this thread.
+void AccCacheThreadEnd();
 //HRESULT AccUiaFromMSAA(IAccessible* msaa, int elem, out IAccessible** iacc);
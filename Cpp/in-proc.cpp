@@ -226,6 +226,7 @@ namespace outproc {
 #pragma endregion
 
 namespace uia { bool UiaDisconnectWrappers(); }
+void AccCacheThreadEnd();
 
 namespace inproc {
 	//Thread proc that unloads this dll.
@@ -271,6 +272,8 @@ namespace inproc {
 			}
 			t_agentWnd = 0;
 
+			AccCacheThreadEnd(); //unhook before the dll is unloaded
+
 			if (0 == InterlockedDecrement(&s_nAgentThreads)) {
 				//unload dll
 				CloseHandle(CreateThread(null, 64 * 1024, UnloadDllThreadProc, null, 0, null));
@@ -38,6 +38,16 @@ enum class eAccFindCallbackResult { Continue, SkipChildren, StopFound, StopNotFo
 //Type of callback functor that receives results of the AO finder.
 using AccFindCallback = const std::function <eAccFindCallbackResult(Cpp_Acc a, int state, int nSiblings)>;
 
+//Used to get find-all results in chunks (see Cpp_AccFind). AccFind stops after finding maxFound AO and sets the position; the next AccFind continues from there.
+struct AccFindPosition {
+	static const int c_maxLevel = 100; //does not stop at deeper AO
+	int maxFound; //in: stop when the callback returned Continue this number of times
+	int nFound; //out: the number of times the callback returned Continue
+	int depth; //in: the number of path elements, or 0 if not continuing. Out: the number of path elements, or 0 if not stopped.
+	bool skipChildren; //in/out: don't search in the last AO of the path (eg MENUITEM)
+	int path[c_maxLevel]; //in/out: path[level] is the index of the AO at that level among children of its parent, in the search order
+};
+
 //STR name and str::Wildex value.
 struct NameValue {
 	STR name;
@@ -125,6 +135,7 @@ namespace outproc {
 		Bstr _br;
 		Smart<IStream> _stream;
 		DWORD _resultSize;
+		DWORD _trailerSize = 0;
 	public:
 		//Allocates memory to pass parameters.
 		//Writes MarshalParams_Header fields. Then let the caller cast the return value to MarshalParams_AccFind* etc and write other fields.
@@ -167,6 +178,18 @@ namespace outproc {
 
 		HRESULT ReadResultAcc(ref Cpp_Acc& a, bool dontNeedAO = false, RECT* rect = null);
 
+		//Gets the trailer data that ends the result: data, then DWORD data size. Used when find-all results are returned in chunks.
+		//Then ReadResultAcc does not read the trailer. Call before it.
+		//Returns null if there is no trailer.
+		const BYTE* ReadResultTrailer(out DWORD& size) {
+			auto b = (const BYTE*)_br.m_str; DWORD n = _br.ByteLength();
+			if (n < 4) return null;
+			size = *(DWORD*)(b + n - 4);
+			if (size == 0 || size > n - 4) return null;
+			_trailerSize = size + 4;
+			return b + n - _trailerSize;
+		}
+
 		BSTR DetachResultBSTR() {
 			return _br.Detach();
 		}
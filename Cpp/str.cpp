@@ -1,29 +1,79 @@
 #include "stdafx.h"
 #include "cpp.h"
-#include "MemoryPool.h"
+#include "SlabPool.h"
+#include <intrin.h>
+#if _M_ARM64
+#include <arm_neon.h>
+#endif
 
 namespace str
 {
 
+#if !_M_ARM64
+//Returns true if the CPU and OS support AVX2.
+static bool _CpuHasAvx2() {
+	int r[4];
+	__cpuid(r, 0); if (r[0] < 7) return false;
+	__cpuid(r, 1); if ((r[2] & (3 << 27)) != (3 << 27)) return false; //OSXSAVE, AVX
+	if ((_xgetbv(0) & 6) != 6) return false; //OS saves XMM and YMM
+	__cpuidex(r, 7, 0);
+	return r[1] & (1 << 5);
+}
+
+static const bool s_avx2 = _CpuHasAvx2();
+#endif
+
 #pragma region Like, Equals, lowercase table
 
+//Lowercase versions of ASCII characters. Used for the ASCII fast path, which does not need the big table.
+static constexpr struct _AsciiLowerTable {
+	WCHAR a[128];
+	constexpr _AsciiLowerTable() : a() { for(int i = 0; i < 128; i++) a[i] = (WCHAR)(i >= 'A' && i <= 'Z' ? i + 32 : i); }
+} s_asciiLower;
+
+//Bits of 256-character blocks that contain characters with lowercase mappings, ie where CharLowerBuff can change something.
+//Generated from UnicodeData.txt (uppercase and titlecase letters, and characters with simple lowercase mappings).
+//	Blocks: 00-05 (Latin, IPA, Greek, Cyrillic, Armenian), 10 (Georgian), 13 (Cherokee), 1C (Cyrillic Extended-C, Georgian Mtavruli), 1E-1F (Latin Extended Additional, Greek Extended),
+//	21 (letterlike symbols, Roman numerals), 24 (circled letters), 2C (Glagolitic, Latin Extended-C, Coptic), A6-A7 (Cyrillic Extended-B, Latin Extended-D), FF (fullwidth Latin).
+//	The other 239 blocks (CJK, Hangul, surrogates, private use etc) are identity. Cpp_TestLowercaseTable compares the result with CharLowerBuff of all characters.
+static constexpr UINT s_caseBlocks[8] = { 0xD009003F, 0x00001012, 0, 0, 0, 0x000000C0, 0, 0x80000000 };
+
 static WCHAR _caseTable[0x10000];
-static bool _caseTableCreated;
+static STR _caseTablePublished; //_caseTable when created. Read with ReadPointerAcquire.
+static INIT_ONCE _caseTableOnce = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK _CreateCaseTable(PINIT_ONCE, PVOID, PVOID*)
+{
+	//identity. The compiler vectorizes this loop.
+	LPWSTR t = _caseTable;
+	for(UINT i = 0; i < 0x10000; i++) t[i] = (WCHAR)i;
+
+	//CharLowerBuff only for blocks that have lowercase mappings. It's the slowest part; for all 0x10000 characters it was 350.
+	for(UINT b = 0; b < 256; b++) {
+		if(s_caseBlocks[b >> 5] & (1u << (b & 31))) CharLowerBuff(t + b * 256, 256);
+	}
+
+	WritePointerRelease((PVOID*)&_caseTablePublished, t);
+	return TRUE;
+}
 
 //Returns static WCHAR table[0x10000] containing all Unicode characters in that range. Uppercase characters converted to lowercase.
+//Thread-safe. Creates the table when called the first time.
 EXPORT STR Cpp_LowercaseTable()
 {
-	if(!_caseTableCreated) {
-		LPWSTR t = _caseTable;
-		for(size_t i = 0; i < 0x10000; i++) t[i] = (WCHAR)i;
-		CharLowerBuff(t, 0x10000);
-		_caseTableCreated = true;
-	} //speed: 350
+	InitOnceExecuteOnce(&_caseTableOnce, _CreateCaseTable, null, null); //speed: 25
 	return _caseTable;
 }
 
 inline STR _LowercaseTable() {
-	return _caseTableCreated ? _caseTable : Cpp_LowercaseTable();
+	STR t = (STR)ReadPointerAcquire((PVOID*)&_caseTablePublished);
+	return t ? t : Cpp_LowercaseTable();
+}
+
+//Returns lowercase c. If c is ASCII, does not use the big table.
+//Note: a non-ASCII character can be lowercased to ASCII, eg KELVIN SIGN to 'k'. ASCII characters are never lowercased to non-ASCII.
+inline WCHAR _LowerChar(size_t c) {
+	return c < 128 ? s_asciiLower.a[c] : _LowercaseTable()[c];
 }
 
 //Compares string s of length lenS with wildcard pattern w of length lenW.
@@ -36,7 +86,6 @@ bool Like(STR s, size_t lenS, STR w, size_t lenW, bool ignoreCase /*= false*/)
 	if(lenW == 1 && w[0] == '*') return true;
 	if(lenS == 0) return false;
 
-	STR table = ignoreCase ? _LowercaseTable() : null;
 	STR se = s + lenS, we = w + lenW;
 
 	//find '*' from start. Makes faster in some cases.
@@ -44,7 +93,7 @@ bool Like(STR s, size_t lenS, STR w, size_t lenW, bool ignoreCase /*= false*/)
 		size_t cS = s[0], cW = w[0];
 		if(cW == '*') goto g1;
 		if(cW == cS || cW == '?') continue;
-		if((table == null) || (table[cW] != table[cS])) return false;
+		if(!ignoreCase || _LowerChar(cW) != _LowerChar(cS)) return false;
 	}
 	if(w == we) return s == se; //w ended?
 	goto gr; //s ended
@@ -55,7 +104,7 @@ g1:
 		size_t cS = se[-1], cW = we[-1];
 		if(cW == '*') break;
 		if(cW == cS || cW == '?') continue;
-		if((table == null) || (table[cW] != table[cS])) return false;
+		if(!ignoreCase || _LowerChar(cW) != _LowerChar(cS)) return false;
 	}
 
 	//Algorithm by Alessandro Felice Cantatore, http://xoomer.virgilio.it/acantato/dev/wildcard/wildmatch.html
@@ -71,7 +120,7 @@ g1:
 			size_t sW = w[i];
 			if(sW == '*') goto gStar;
 			if(sW == s[i] || sW == '?') continue;
-			if((table != null) && (table[sW] == table[s[i]])) continue;
+			if(ignoreCase && _LowerChar(sW) == _LowerChar(s[i])) continue;
 			s++; i = -1;
 		}
 
@@ -93,9 +142,80 @@ gr:
 	//The first two loops are fast, but Equals much faster when !ignoreCase. We cannot use its optimizations.
 	//The slowest case is "*substring*", because then the first two loops don't help.
 	//	Then similar speed as string.IndexOf(ordinal) and API <msdn>FindStringOrdinal</msdn>.
-	//	Possible optimization, but need to add much code, and makes not much faster, and makes other cases slower, difficult to avoid it.
+	//	Wildex does not use this function. It compiles the wildcard expression in Parse, and then finds "*substring*" etc with Find, which uses SIMD.
+}
+
+//Case-insensitive Equals of strings of the same length. Called by Equals when the strings are long enough for SIMD.
+//In each vector, lanes that are equal after folding ASCII letters are equal. Other lanes are different if both characters are ASCII; else compares them with _LowerChar.
+//The last vector overlaps the previous, therefore no scalar tail loop.
+
+//Returns true if lanes in bit mask bad (n lanes, bitsPerLane bits per lane) are equal case-insensitive.
+static bool _EqualsILanes(STR w, STR s, int n, unsigned __int64 bad, int bitsPerLane) {
+	for(int k = 0; k < n; k++, bad >>= bitsPerLane) {
+		if((bad & 1) && _LowerChar(w[k]) != _LowerChar(s[k])) return false;
+	}
+	return true;
+}
+
+#if _M_ARM64
+
+//NEON version. len must be >= 8.
+static bool _EqualsINeon(STR w, STR s, size_t len) {
+	uint16x8_t a = vdupq_n_u16('A'), z = vdupq_n_u16('Z' - 'A'), x20 = vdupq_n_u16(0x20), hi = vdupq_n_u16(0x7F);
+	for(size_t i = 0; ; i += 8) {
+		if(i + 8 > len) { if(i == len) return true; i = len - 8; }
+		uint16x8_t x = vld1q_u16((const uint16_t*)w + i), y = vld1q_u16((const uint16_t*)s + i);
+		if(vminvq_u16(vceqq_u16(x, y)) != 0) continue;
+		uint16x8_t fx = vorrq_u16(x, vandq_u16(vcleq_u16(vsubq_u16(x, a), z), x20));
+		uint16x8_t fy = vorrq_u16(y, vandq_u16(vcleq_u16(vsubq_u16(y, a), z), x20));
+		uint16x8_t bad = vmvnq_u16(vceqq_u16(fx, fy)), nonAscii = vcgtq_u16(vorrq_u16(x, y), hi);
+		if(vmaxvq_u16(vbicq_u16(bad, nonAscii)) != 0) return false;
+		unsigned __int64 mask = vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(bad)), 0); //8 bits per lane
+		if(mask && !_EqualsILanes(w + i, s + i, 8, mask, 8)) return false;
+	}
+}
+
+#else
+
+//SSE2 version. len must be >= 8.
+static bool _EqualsISse2(STR w, STR s, size_t len) {
+	//x is 'A'-'Z' if (short)(x + 0x8000 - 'A') < (short)(0x8000 + 26). SSE2 has only signed compare.
+	__m128i bias = _mm_set1_epi16((short)(0x8000 - 'A')), upper = _mm_set1_epi16((short)(0x8000 + 26));
+	__m128i x20 = _mm_set1_epi16(0x20), hi = _mm_set1_epi16((short)0xFF80), zero = _mm_setzero_si128();
+	for(size_t i = 0; ; i += 8) {
+		if(i + 8 > len) { if(i == len) return true; i = len - 8; }
+		__m128i x = _mm_loadu_si128((const __m128i*)(w + i)), y = _mm_loadu_si128((const __m128i*)(s + i));
+		if(_mm_movemask_epi8(_mm_cmpeq_epi16(x, y)) == 0xFFFF) continue;
+		__m128i fx = _mm_or_si128(x, _mm_and_si128(_mm_cmplt_epi16(_mm_add_epi16(x, bias), upper), x20));
+		__m128i fy = _mm_or_si128(y, _mm_and_si128(_mm_cmplt_epi16(_mm_add_epi16(y, bias), upper), x20));
+		unsigned bad = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi16(fx, fy)) & 0xFFFF; //2 bits per lane
+		unsigned ascii = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(x, y), hi), zero));
+		if(bad & ascii) return false;
+		if(bad && !_EqualsILanes(w + i, s + i, 8, bad, 2)) return false;
+	}
+}
+
+//AVX2 version. len must be >= 16.
+static bool _EqualsIAvx2(STR w, STR s, size_t len) {
+	__m256i bias = _mm256_set1_epi16((short)(0x8000 - 'A')), upper = _mm256_set1_epi16((short)(0x8000 + 26));
+	__m256i x20 = _mm256_set1_epi16(0x20), hi = _mm256_set1_epi16((short)0xFF80), zero = _mm256_setzero_si256();
+	bool R = true;
+	for(size_t i = 0; ; i += 16) {
+		if(i + 16 > len) { if(i == len) break; i = len - 16; }
+		__m256i x = _mm256_loadu_si256((const __m256i*)(w + i)), y = _mm256_loadu_si256((const __m256i*)(s + i));
+		if(_mm256_movemask_epi8(_mm256_cmpeq_epi16(x, y)) == -1) continue;
+		__m256i fx = _mm256_or_si256(x, _mm256_and_si256(_mm256_cmpgt_epi16(upper, _mm256_add_epi16(x, bias)), x20)); //AVX2 has only cmpgt
+		__m256i fy = _mm256_or_si256(y, _mm256_and_si256(_mm256_cmpgt_epi16(upper, _mm256_add_epi16(y, bias)), x20));
+		unsigned bad = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi16(fx, fy)); //2 bits per lane
+		unsigned ascii = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_and_si256(_mm256_or_si256(x, y), hi), zero));
+		if((bad & ascii) || (bad && !_EqualsILanes(w + i, s + i, 16, bad, 2))) { R = false; break; }
+	}
+	_mm256_zeroupper();
+	return R;
 }
 
+#endif
+
 //Compares string s of length lenS with string w of length lenW.
 //Returns true if match. Returns false if s==null. Exception if w==null.
 //EXPORT //C# has own function. Calling this from C# is significantly slower when string short.
@@ -106,20 +226,17 @@ bool Equals(STR w, size_t lenW, STR s, size_t lenS, bool ignoreCase /*= false*/)
 
 	if(!ignoreCase) return 0 == memcmp(s, w, lenW * 2); //fastest
 
-	//optimization: at first compare case-sensitive, as much as possible.
-	//	never mind: in 32-bit process this is not the fastest code (too few registers). But makes much faster anyway.
-	//	tested: strings don't have to be aligned at 4 or 8.
-	while(lenW >= 12) {
-		if(*(__int64*)w != *(__int64*)s) break;
-		if(*(__int64*)(w + 4) != *(__int64*)(s + 4)) break;
-		if(*(__int64*)(w + 8) != *(__int64*)(s + 8)) break;
-		w += 12; s += 12; lenW -= 12;
-	}
+	//SIMD: folds ASCII letters in all lanes, and compares non-ASCII lanes with the lowercase table.
+#if _M_ARM64
+	if(lenW >= 8) return _EqualsINeon(w, s, lenW);
+#else
+	if(lenW >= 16 && s_avx2) return _EqualsIAvx2(w, s, lenW);
+	if(lenW >= 8) return _EqualsISse2(w, s, lenW);
+#endif
 
-	auto table = _LowercaseTable();
 	for(size_t i = 0; i < lenW; i++) {
 		size_t c1 = w[i], c2 = s[i];
-		if(c1 != c2 && table[c1] != table[c2]) goto gFalse;
+		if(c1 != c2 && _LowerChar(c1) != _LowerChar(c2)) goto gFalse;
 	}
 	return true; gFalse: return false;
 }
@@ -150,6 +267,131 @@ bool Equals(STR w, size_t lenW, STR s, size_t lenS, bool ignoreCase /*= false*/)
 
 #pragma endregion
 
+#pragma region Find
+
+//SIMD filter for Find. Compares a vector of characters with the first or last character of the substring.
+//Lane matches if (c | orMask) == ch, or if c > nonAscii (then the lane is verified with the lowercase table).
+struct _FindFilter {
+	WCHAR ch, orMask, nonAscii;
+
+	_FindFilter(WCHAR c, bool ignoreCase) {
+		orMask = 0; nonAscii = 0xFFFF; //0xFFFF - never
+		if (!ignoreCase) { ch = c; return; }
+		ch = _LowerChar(c);
+		//Non-ASCII characters can be lowercased to ASCII, eg KELVIN SIGN to 'k'. ASCII can't be lowercased to non-ASCII.
+		nonAscii = 0x7F;
+		if (ch >= 128) ch = 0xFFFF; //only non-ASCII lanes can match
+		else if (ch >= 'a' && ch <= 'z') orMask = 0x20;
+	}
+};
+
+//Returns true if substring w matches s at this position. Used by Find to verify SIMD candidates.
+static bool _FindVerify(STR s, STR w, size_t lenW, bool ignoreCase) {
+	if (!ignoreCase) return 0 == memcmp(s, w, lenW * 2);
+	return Equals(w, lenW, s, lenW, true);
+}
+
+#if _M_ARM64
+
+//NEON version of the Find loop. Processes 8 positions per iteration, while i + 8 <= n.
+//Returns true if found; then i is the index.
+static bool _FindNeon(STR s, size_t n, STR w, size_t lenW, bool ignoreCase, ref size_t& i) {
+	_FindFilter f1(w[0], ignoreCase), f2(w[lenW - 1], ignoreCase);
+	uint16x8_t c1 = vdupq_n_u16(f1.ch), o1 = vdupq_n_u16(f1.orMask), h1 = vdupq_n_u16(f1.nonAscii);
+	uint16x8_t c2 = vdupq_n_u16(f2.ch), o2 = vdupq_n_u16(f2.orMask), h2 = vdupq_n_u16(f2.nonAscii);
+	for (; i + 8 <= n; i += 8) {
+		uint16x8_t x1 = vld1q_u16((const uint16_t*)s + i), x2 = vld1q_u16((const uint16_t*)s + i + lenW - 1);
+		uint16x8_t m1 = vorrq_u16(vceqq_u16(vorrq_u16(x1, o1), c1), vcgtq_u16(x1, h1));
+		uint16x8_t m2 = vorrq_u16(vceqq_u16(vorrq_u16(x2, o2), c2), vcgtq_u16(x2, h2));
+		unsigned __int64 mask = vget_lane_u64(vreinterpret_u64_u8(vmovn_u16(vandq_u16(m1, m2))), 0); //8 bits per lane
+		while (mask) {
+			unsigned long bit; _BitScanForward64(&bit, mask);
+			if (_FindVerify(s + i + bit / 8, w, lenW, ignoreCase)) { i += bit / 8; return true; }
+			mask &= ~(0xFFull << bit);
+		}
+	}
+	return false;
+}
+
+#else
+
+//SSE2 version of the Find loop. Processes 8 positions per iteration, while i + 8 <= n.
+//Returns true if found; then i is the index.
+static bool _FindSse2(STR s, size_t n, STR w, size_t lenW, bool ignoreCase, ref size_t& i) {
+	_FindFilter f1(w[0], ignoreCase), f2(w[lenW - 1], ignoreCase);
+	//SSE2 has only signed compare. x > nonAscii (unsigned) is the same as (x ^ 0x8000) > (nonAscii ^ 0x8000) (signed).
+	__m128i sign = _mm_set1_epi16((short)0x8000);
+	__m128i c1 = _mm_set1_epi16((short)f1.ch), o1 = _mm_set1_epi16((short)f1.orMask), h1 = _mm_set1_epi16((short)(f1.nonAscii ^ 0x8000));
+	__m128i c2 = _mm_set1_epi16((short)f2.ch), o2 = _mm_set1_epi16((short)f2.orMask), h2 = _mm_set1_epi16((short)(f2.nonAscii ^ 0x8000));
+	for (; i + 8 <= n; i += 8) {
+		__m128i x1 = _mm_loadu_si128((const __m128i*)(s + i)), x2 = _mm_loadu_si128((const __m128i*)(s + i + lenW - 1));
+		__m128i m1 = _mm_or_si128(_mm_cmpeq_epi16(_mm_or_si128(x1, o1), c1), _mm_cmpgt_epi16(_mm_xor_si128(x1, sign), h1));
+		__m128i m2 = _mm_or_si128(_mm_cmpeq_epi16(_mm_or_si128(x2, o2), c2), _mm_cmpgt_epi16(_mm_xor_si128(x2, sign), h2));
+		unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(m1, m2)); //2 bits per lane
+		while (mask) {
+			unsigned long bit; _BitScanForward(&bit, mask);
+			if (_FindVerify(s + i + bit / 2, w, lenW, ignoreCase)) { i += bit / 2; return true; }
+			mask &= ~(3u << bit);
+		}
+	}
+	return false;
+}
+
+//AVX2 version of the Find loop. Processes 16 positions per iteration, while i + 16 <= n.
+//Returns true if found; then i is the index.
+static bool _FindAvx2(STR s, size_t n, STR w, size_t lenW, bool ignoreCase, ref size_t& i) {
+	_FindFilter f1(w[0], ignoreCase), f2(w[lenW - 1], ignoreCase);
+	__m256i sign = _mm256_set1_epi16((short)0x8000);
+	__m256i c1 = _mm256_set1_epi16((short)f1.ch), o1 = _mm256_set1_epi16((short)f1.orMask), h1 = _mm256_set1_epi16((short)(f1.nonAscii ^ 0x8000));
+	__m256i c2 = _mm256_set1_epi16((short)f2.ch), o2 = _mm256_set1_epi16((short)f2.orMask), h2 = _mm256_set1_epi16((short)(f2.nonAscii ^ 0x8000));
+	bool R = false;
+	for (; i + 16 <= n; i += 16) {
+		__m256i x1 = _mm256_loadu_si256((const __m256i*)(s + i)), x2 = _mm256_loadu_si256((const __m256i*)(s + i + lenW - 1));
+		__m256i m1 = _mm256_or_si256(_mm256_cmpeq_epi16(_mm256_or_si256(x1, o1), c1), _mm256_cmpgt_epi16(_mm256_xor_si256(x1, sign), h1));
+		__m256i m2 = _mm256_or_si256(_mm256_cmpeq_epi16(_mm256_or_si256(x2, o2), c2), _mm256_cmpgt_epi16(_mm256_xor_si256(x2, sign), h2));
+		unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(m1, m2)); //2 bits per lane
+		while (mask) {
+			unsigned long bit; _BitScanForward(&bit, mask);
+			if (_FindVerify(s + i + bit / 2, w, lenW, ignoreCase)) { i += bit / 2; R = true; goto g1; }
+			mask &= ~(3u << bit);
+		}
+	}
+g1:
+	_mm256_zeroupper();
+	return R;
+}
+
+#endif
+
+//Finds substring w of length lenW in string s of length lenS.
+//Returns 0-based index, or -1 if not found or if s==null. If lenW==0, returns 0. Exception if w==null.
+//Uses SIMD (SSE2 or AVX2, or NEON on ARM64) to find candidates where the first and last characters match. Then compares all characters.
+//	If ignoreCase, folds ASCII letters in the SIMD filter; lanes with non-ASCII characters are verified with the lowercase table.
+//Used by Wildex for "*substring*".
+int Find(STR s, size_t lenS, STR w, size_t lenW, bool ignoreCase /*= false*/)
+{
+	if(s == null || lenW > lenS) return -1;
+	if(lenW == 0) return 0;
+
+	size_t n = lenS - lenW + 1, i = 0; //n - number of possible positions
+
+#if _M_ARM64
+	if(n >= 8 && _FindNeon(s, n, w, lenW, ignoreCase, ref i)) return (int)i;
+#else
+	if(n >= 16 && s_avx2 && _FindAvx2(s, n, w, lenW, ignoreCase, ref i)) return (int)i;
+	if(n >= 8 && _FindSse2(s, n, w, lenW, ignoreCase, ref i)) return (int)i;
+#endif
+
+	if(!ignoreCase) {
+		for(WCHAR c = w[0]; i < n; i++) if(s[i] == c && _FindVerify(s + i, w, lenW, false)) return (int)i;
+	} else {
+		for(WCHAR c = _LowerChar(w[0]); i < n; i++) if(_LowerChar(s[i]) == c && _FindVerify(s + i, w, lenW, true)) return (int)i;
+	}
+	return -1;
+}
+
+#pragma endregion
+
 //EXPORT void Cpp_Free(void* p) {
 //	if(p) free(p);
 //}
@@ -173,9 +415,31 @@ BSTR _GetErrorMessage(int code, int compileErrorOffset)
 
 //Calls pcre2_get_error_message_16 and returns SysAllocString.
 BSTR GetErrorMessage(int code) {
+	if (code == c_rxErrorTimeout) return SysAllocString(L"match time limit exceeded");
 	return _GetErrorMessage(code, -1);
 }
 
+//Thread-local compile contexts for different extra options.
+//Newline and \R conventions are not in the key; our API does not set them (a pattern can use eg (*CRLF)). Character tables are the default tables, which are static.
+struct _CcCache {
+	static const int c_n = 4;
+	pcre2_compile_context_16* cc[c_n];
+	UINT extra[c_n];
+	int next; //cc to replace when need another
+};
+thread_local _CcCache t_cc;
+
+//Gets thread-local compile context with extra options. Returns null if failed to allocate.
+static pcre2_compile_context_16* _GetCC(UINT extra) {
+	_CcCache& t = t_cc;
+	for (int i = 0; i < t.c_n; i++) if (t.cc[i] && t.extra[i] == extra) return t.cc[i];
+	int i = t.next; t.next = (i + 1) % t.c_n;
+	if (!t.cc[i] && !(t.cc[i] = pcre2_compile_context_create_16(null))) return null;
+	pcre2_set_compile_extra_options_16(t.cc[i], extra);
+	t.extra[i] = extra;
+	return t.cc[i];
+}
+
 //Calls pcre2_compile_16.
 //This version is used in this dll, eg by Wildex.
 //Adds PCRE2_UTF if rx contains non-ASCII characters and flags does not contain PCRE2_UTF or PCRE2_NEVER_UTF.
@@ -191,13 +455,7 @@ pcre2_code_16* Compile(STR rx, size_t len, __int64 flags /*= 0*/, out BSTR* errS
 		for(size_t i = 0; i < len; i++) if(rx[i] >= 128) { f |= PCRE2_UTF; break; }
 	}
 
-	pcre2_compile_context_16* cc = null;
-	if(fe) {
-		cc = pcre2_compile_context_create_16(null);
-		pcre2_set_compile_extra_options_16(cc, fe);
-	}
-	auto re = pcre2_compile_16(rx, len, f, &errCode, &errOffset, cc);
-	if(cc) pcre2_compile_context_free_16(cc);
+	auto re = pcre2_compile_16(rx, len, f, &errCode, &errOffset, fe ? _GetCC(fe) : null);
 	if(re == null) {
 		if(errStr)* errStr = _GetErrorMessage(errCode, (int)errOffset);
 		return null;
@@ -237,86 +495,237 @@ EXPORT int Cpp_RegexDtor(pcre2_code_16* code)
 	return (int)codeSize;
 }
 
-struct _RxMdVec { CHeapPtr<POINT> a; int n; };
+//Splits n items into nThreads ranges and calls f(from, to) for each range. Waits until all done.
+//Ranges are processed by this thread and by threads of the process default thread pool. Pool threads keep their thread-local PCRE data for the next call.
+template<class F>
+static void _Parallel(int n, int nThreads, F&& f) {
+	struct _Ranges {
+		F* f; int n, nRanges; long next;
 
-//After upgrading PCRE library, this reminds to check/reapply its modifications. Then edit this line.
-//More info in config.h in PCRE project.
-static_assert(PCRE2_MAJOR == 10 && PCRE2_MINOR == 46);
+		void Run() {
+			for(int i; (i = InterlockedIncrement(&next) - 1) < nRanges; ) (*f)((int)((__int64)n * i / nRanges), (int)((__int64)n * (i + 1) / nRanges));
+		}
+	} r = { &f, n, max(nThreads, 1), 0 };
+
+	PTP_WORK work = null;
+	if(r.nRanges > 1 && (work = CreateThreadpoolWork([](PTP_CALLBACK_INSTANCE, PVOID p, PTP_WORK) { ((_Ranges*)p)->Run(); }, &r, null))) {
+		for(int i = 1; i < r.nRanges; i++) SubmitThreadpoolWork(work);
+	} //else this thread processes all ranges
+	r.Run();
+	if(work) {
+		WaitForThreadpoolWorkCallbacks(work, true); //cancel callbacks that did not start; all ranges are taken now
+		CloseThreadpoolWork(work);
+	}
+}
 
-//Cpp_RegexMatch results.
-struct RegexMatch
+//Compiles n regular expressions. The same as Cpp_RegexCompile for each, but can be faster when there are many, because can use multiple threads.
+//nThreads - max number of threads, including this thread.
+//Returns the number of successfully compiled.
+EXPORT int Cpp_RegexCompileBulk(RegexCompileItem* a, int n, int nThreads = 1)
 {
-	//[out] Array that receives x=from and y=to of match and submatches.
-	//Func allocates thread-local memory for it. Then caller copies it ASAP and does not free.
-	//tested: this is the fastest way when caller is C#.
-	//Func sets it on full and partial match. Else sets null.
-	POINT* vec;
-
-	//[out] vec element count: pcre2_get_ovector_count_16 if matched, 0 if not, 1 if partial.
-	int vecCount;
-
-	//[out] pcre2_get_startchar_16.
-	int indexNoK;
+	const int c_minPerThread = 50; //compiling a regex is much slower than passing a work item to a pool thread
+	_Parallel(n, min(nThreads, n / c_minPerThread), [a](int from, int to) {
+		for(int i = from; i < to; i++) {
+			auto& x = a[i];
+			x.errStr = null;
+			x.code = Cpp_RegexCompile(x.rx, x.len, x.flags, x.codeSize, &x.errStr);
+		}
+	});
+	int R = 0;
+	for(int i = 0; i < n; i++) if(a[i].code) R++;
+	return R;
+}
 
-	//[out] pcre2_get_mark_16.
-	STR mark;
-};
+struct _RxMdVec { CHeapPtr<POINT> a; int n; };
 
-#define FAST_MD
+//After upgrading PCRE library, this reminds to check/reapply its modifications. Then edit this line.
+//More info in config.h in PCRE project.
+static_assert(PCRE2_MAJOR == 10 && PCRE2_MINOR == 46);
 
 static void* _mp_malloc(size_t size, void* data) {
-	auto mp = (AppShift::Memory::MemoryPool*)data;
-	return mp->allocate(size);
+	return ((SlabPool*)data)->Alloc(size);
 }
 
 static void _mp_free(void* block, void* data) {
-	auto mp = (AppShift::Memory::MemoryPool*)data;
-	mp->free(block);
+	((SlabPool*)data)->Free(block);
 }
 
-thread_local AppShift::Memory::MemoryPool* t_mp;
+//SlabPool of a thread, with data for trimming.
+struct _ThreadPool : SlabPool {
+	volatile LONG trimRequested; //Cpp_RegexTrim of another thread asks to free heap frames
+	int nMatches; //since the last trim
+	_ThreadPool() noexcept : trimRequested(0), nMatches(0) {}
+};
+
+thread_local _ThreadPool* t_mp;
 thread_local pcre2_general_context_16* t_gc;
 
-//Gets thread_local pcre2_general_context_16 that uses memory pool.
+//SlabPools of all threads, for Cpp_RegexMemoryStats and Cpp_RegexTrim.
+static std::vector<_ThreadPool*> s_pools;
+static SlabPool::Stats s_poolsExited; //counters of pools of exited threads
+static SRWLOCK s_poolsLock = SRWLOCK_INIT;
+
+//Gets thread_local pcre2_general_context_16 that uses a SlabPool. Used for match data and heap frames.
 static pcre2_general_context_16* _GetGC() {
 	auto gc = t_gc;
 	if (gc == null) {
-		t_mp = new AppShift::Memory::MemoryPool(25000); //#define START_FRAMES_SIZE 20480, and some for small allocations
-		t_gc = gc = pcre2_general_context_create_16(_mp_malloc, _mp_free, t_mp);
+		auto mp = new _ThreadPool();
+		t_gc = gc = pcre2_general_context_create_16(_mp_malloc, _mp_free, static_cast<SlabPool*>(mp));
+		if (gc == null) { delete mp; return null; }
+		t_mp = mp;
+		AcquireSRWLockExclusive(&s_poolsLock);
+		s_pools.push_back(mp);
+		ReleaseSRWLockExclusive(&s_poolsLock);
 	}
 	return gc;
 }
 
-void thread_detach() {
-	if (t_mp == nullptr) return;
-	delete t_mp;
+static void _DeletePool() {
+	auto mp = t_mp;
+	if (mp == nullptr) return;
+	pcre2_general_context_free_16(t_gc);
+	AcquireSRWLockExclusive(&s_poolsLock);
+	std::erase(s_pools, mp);
+	auto t = mp->GetStats();
+	t.reserved = t.live = 0; t.nChunks = t.nLargeCached = 0;
+	s_poolsExited.Add(t);
+	ReleaseSRWLockExclusive(&s_poolsLock);
+	delete mp;
 	t_mp = nullptr;
 	t_gc = nullptr;
 }
 
-//Calls pcre2_match_16 and returns its return value. If PCRE2_ERROR_PARTIAL, returns 0.
-//Allocates/frees match data in a fast way. Copies results to m, if not null.
-//errStr, if not null, receives error text when fails, except when no match or partial match. Caller then must SysFreeString it.
-//This version is called from C#. In this dll you can use Free; use this func when need match data (ovector etc).
-EXPORT int Cpp_RegexMatch(pcre2_code_16* code, STR s, size_t len, size_t start = 0, UINT flags = 0,
-	int(*callout)(pcre2_callout_block*, void*) = null, ref RegexMatch * m = null, bool needM = true, out BSTR * errStr = null)
-{
+//Thread-local match context for Cpp_RegexMatchBudget. Each call sets its limits.
+thread_local pcre2_match_context_16* t_mcBudget;
+
+//Thread-local match data, reused by Match and Cpp_RegexMatch, to avoid allocator work in each call.
+//Its ovector size is of the pattern with most groups matched in this thread.
+//pcre2_match_16 keeps its heap frames vector in match data and reuses it, therefore the frames survive across calls too.
+struct _MdCache {
 	pcre2_match_data_16* md;
-#ifdef FAST_MD
-	md = pcre2_match_data_create_from_pattern_16(code, _GetGC());
-	//tested: startScope/endScope usually makes slightly slower.
-#else
-	md = pcre2_match_data_create_from_pattern_16(code, null);
-#endif
+	UINT ovecCount; //of md
+	bool busy; //md is used by a pcre2_match_16 call that is still running, eg it called a callout that calls Cpp_RegexMatch
+};
+thread_local _MdCache t_md;
+
+//If heap frames become bigger (eg a complex regex and long string), _ReleaseMatchData frees the match data, to free the memory.
+static const size_t c_mdMaxHeapFrames = 1024 * 1024;
+
+//Threads are rarely detached (eg thread pool threads), therefore every c_trimInterval matches _ReleaseMatchData trims memory if the thread's pool has more than c_trimThreshold bytes.
+//Smaller heap frames are kept. PCRE allocates 20 KB initially (START_FRAMES_SIZE).
+static const int c_trimInterval = 1000;
+static const size_t c_trimThreshold = 256 * 1024, c_trimMinHeapFrames = 20480;
+
+//Frees big heap frames of the thread-local match data and unused memory of the thread's pool.
+//If !always, does it only if the pool has more than c_trimThreshold bytes.
+//Returns the number of freed bytes.
+static size_t _TrimThread(bool always) {
+	auto mp = t_mp;
+	if (mp == nullptr) return 0;
+	mp->nMatches = 0;
+	InterlockedExchange(&mp->trimRequested, 0);
+	size_t r = mp->GetStats().reserved;
+	if (!always && r <= c_trimThreshold) return 0;
+	_MdCache& t = t_md;
+	if (t.md && !t.busy && pcre2_get_match_data_heapframes_size_16(t.md) > c_trimMinHeapFrames) {
+		pcre2_match_data_free_16(t.md);
+		t.md = null; t.ovecCount = 0;
+	}
+	mp->Trim();
+	return r - mp->GetStats().reserved;
+}
+
+//Gets match data for code. Usually it is t_md.md; if busy, creates new match data. Call _ReleaseMatchData when done.
+//ovecCount receives the number of ovector pairs used by code (groups + 1). Note: it can be less than pcre2_get_ovector_count_16(md).
+static pcre2_match_data_16* _GetMatchData(pcre2_code_16* code, out UINT& ovecCount) {
+	UINT nGroups = 0;
+	pcre2_pattern_info_16(code, PCRE2_INFO_CAPTURECOUNT, &nGroups);
+	ovecCount = nGroups + 1;
+
+	_MdCache& t = t_md;
+	if (t.busy) return pcre2_match_data_create_16(ovecCount, _GetGC());
+	if (t.ovecCount < ovecCount) {
+		if (t.md) pcre2_match_data_free_16(t.md);
+		t.md = pcre2_match_data_create_16(ovecCount, _GetGC()); //_GetGC for stats of heap frames
+		t.ovecCount = t.md ? ovecCount : 0;
+		if (!t.md) return null;
+	}
+	t.busy = true;
+	return t.md;
+}
+
+static void _ReleaseMatchData(pcre2_match_data_16* md) {
+	if (md == null) return;
+	_MdCache& t = t_md;
+	if (md != t.md) {
+		pcre2_match_data_free_16(md);
+	} else {
+		t.busy = false;
+		if (pcre2_get_match_data_heapframes_size_16(md) > c_mdMaxHeapFrames) {
+			pcre2_match_data_free_16(md);
+			t.md = null; t.ovecCount = 0;
+		} else if (auto mp = t_mp) {
+			bool trimRequested = ReadNoFence(&mp->trimRequested);
+			if (++mp->nMatches >= c_trimInterval || trimRequested) _TrimThread(trimRequested);
+		}
+	}
+}
+
+void thread_detach() {
+	for (auto& cc : t_cc.cc) if (cc) { pcre2_compile_context_free_16(cc); cc = null; }
+	if (t_md.md) {
+		pcre2_match_data_free_16(t_md.md);
+		t_md.md = null; t_md.ovecCount = 0;
+	}
+	if (t_mcBudget) { pcre2_match_context_free_16(t_mcBudget); t_mcBudget = null; }
+	_DeletePool();
+}
+
+//Gets memory statistics of PCRE match data and heap frames, summed for all threads that used regex.
+//reserved, live, nChunks and nLargeCached are of current threads; nAlloc, nFree, largest and peaks also include exited threads.
+//Returns the number of current threads that have a pool.
+EXPORT int Cpp_RegexMemoryStats(out SlabPool::Stats& r) {
+	AcquireSRWLockShared(&s_poolsLock);
+	r = s_poolsExited;
+	for (auto mp : s_pools) r.Add(mp->GetStats());
+	int n = (int)s_pools.size();
+	ReleaseSRWLockShared(&s_poolsLock);
+	return n;
+}
+
+//Frees unused memory of PCRE match data and heap frames of this thread.
+//If allThreads, also frees unused memory of pools of other threads, and makes them free big heap frames when they match next time.
+//Call this when the process should use less memory, eg when idle or low memory.
+//Returns the number of bytes freed now.
+EXPORT __int64 Cpp_RegexTrim(bool allThreads) {
+	size_t r = _TrimThread(true);
+	if (allThreads) {
+		AcquireSRWLockShared(&s_poolsLock);
+		for (auto mp : s_pools) {
+			if (mp == t_mp) continue;
+			r += mp->Trim();
+			InterlockedExchange(&mp->trimRequested, 1);
+		}
+		ReleaseSRWLockShared(&s_poolsLock);
+	}
+	return r;
+}
 
-	int R = pcre2_match_16(code, s, len, start, flags, md, null, callout);
+//Cpp_RegexMatch and Cpp_RegexMatchBudget implementation.
+static int _RegexMatch(pcre2_code_16* code, STR s, size_t len, size_t start, UINT flags,
+	int(*callout)(pcre2_callout_block*, void*), ref RegexMatch* m, bool needM, pcre2_match_context_16* mc, out BSTR* errStr)
+{
+	UINT ovecCount;
+	auto md = _GetMatchData(code, ovecCount);
+
+	int R = pcre2_match_16(code, s, len, start, flags, md, mc, callout);
 
 	assert(R != 0); //this could be if md contains too small ovector
 	if(R == PCRE2_ERROR_PARTIAL) R = 0;
 
 	if(needM) {
 		//info: read PCRE API doc, section "HOW PCRE2_MATCH() RETURNS A STRING AND CAPTURED SUBSTRINGS"
-		int n = R > 0 ? pcre2_get_ovector_count_16(md) : (R == 0 ? 1 : 0);
+		int n = R > 0 ? (int)ovecCount : (R == 0 ? 1 : 0); //not pcre2_get_ovector_count_16(md); it can be bigger
 		//Printf(L"R=%i, n=%i", R, n);
 
 		if(n == 0) {
@@ -348,41 +757,881 @@ EXPORT int Cpp_RegexMatch(pcre2_code_16* code, STR s, size_t len, size_t start =
 		//FUTURE: if UTF error, in error text include the offset. It seems pcre2_get_startchar_16 returns it.
 	}
 
-	pcre2_match_data_free_16(md);
+	_ReleaseMatchData(md);
+	return R;
+}
+
+//Calls pcre2_match_16 and returns its return value. If PCRE2_ERROR_PARTIAL, returns 0.
+//Uses thread-local match data (does not allocate memory). Copies results to m, if not null.
+//errStr, if not null, receives error text when fails, except when no match or partial match. Caller then must SysFreeString it.
+//This version is called from C#. In this dll you can use Free; use this func when need match data (ovector etc).
+EXPORT int Cpp_RegexMatch(pcre2_code_16* code, STR s, size_t len, size_t start = 0, UINT flags = 0,
+	int(*callout)(pcre2_callout_block*, void*) = null, ref RegexMatch * m = null, bool needM = true, out BSTR * errStr = null)
+{
+	return _RegexMatch(code, s, len, start, flags, callout, m, needM, null, errStr);
+}
+
+//Cpp_RegexMatchBudget periodic callout. data is the deadline, in QueryPerformanceCounter units.
+static int _BudgetTimeout(void* data) {
+	LARGE_INTEGER t; QueryPerformanceCounter(&t);
+	return t.QuadPart > *(__int64*)data ? c_rxErrorTimeout : 0;
+}
+
+static UINT _DefaultLimit(UINT what) {
+	UINT r = 0; pcre2_config_16(what, &r);
+	return r;
+}
+
+//The same as Cpp_RegexMatch, but with limits for untrusted regular expressions or subjects. See RegexBudget.
+//When a limit is exceeded, returns PCRE2_ERROR_MATCHLIMIT, PCRE2_ERROR_DEPTHLIMIT, PCRE2_ERROR_HEAPLIMIT or c_rxErrorTimeout.
+EXPORT int Cpp_RegexMatchBudget(pcre2_code_16* code, STR s, size_t len, size_t start, UINT flags,
+	int(*callout)(pcre2_callout_block*, void*), ref RegexMatch* m, bool needM, const RegexBudget& budget, out BSTR* errStr = null)
+{
+	auto mc = t_mcBudget;
+	if (mc == null) {
+		t_mcBudget = mc = pcre2_match_context_create_16(null);
+		if (mc == null) {
+			if (errStr) *errStr = GetErrorMessage(PCRE2_ERROR_NOMEMORY);
+			return PCRE2_ERROR_NOMEMORY;
+		}
+	}
+	pcre2_set_match_limit_16(mc, budget.matchLimit ? budget.matchLimit : _DefaultLimit(PCRE2_CONFIG_MATCHLIMIT));
+	pcre2_set_depth_limit_16(mc, budget.depthLimit ? budget.depthLimit : _DefaultLimit(PCRE2_CONFIG_DEPTHLIMIT));
+	pcre2_set_heap_limit_16(mc, budget.heapLimit ? budget.heapLimit : _DefaultLimit(PCRE2_CONFIG_HEAPLIMIT));
+
+	//pcre2_match_16 copies the limits and the deadline pointer when it starts, therefore a callout can call this func (nested match).
+	__int64 deadline;
+	if (budget.timeoutMs) {
+		LARGE_INTEGER t, f; QueryPerformanceCounter(&t); QueryPerformanceFrequency(&f);
+		deadline = t.QuadPart + f.QuadPart * budget.timeoutMs / 1000;
+		pcre2_set_periodic_callout_16(mc, _BudgetTimeout, &deadline);
+	} else {
+		pcre2_set_periodic_callout_16(mc, null, null);
+	}
+	return _RegexMatch(code, s, len, start, flags, callout, m, needM, mc, errStr);
+}
+
+//Cpp_RegexMatchBatch worker. Matches subjects from..to, all with the same match data.
+static void _MatchBatch(pcre2_code_16* code, const RegexSubject* a, int from, int to, UINT flags, RegexBatchResult* r, POINT* ovec, int ovecCount) {
+	UINT nPairs;
+	auto md = _GetMatchData(code, nPairs);
+	auto v = md ? pcre2_get_ovector_pointer_16(md) : null;
+	for(int i = from; i < to; i++) {
+		int R = md ? pcre2_match_16(code, a[i].s, a[i].len, 0, flags, md, null, null) : PCRE2_ERROR_NOMEMORY;
+		if(R == PCRE2_ERROR_PARTIAL) R = 0;
+		RegexBatchResult& x = r[i];
+		x.result = R;
+		if(R >= 0) { x.start = (int)v[0]; x.end = (int)v[1]; } else x.start = x.end = -1;
+		if(ovec) {
+			POINT* g = ovec + (size_t)i * ovecCount;
+			for(int j = 0; j < ovecCount; j++) {
+				if(R > 0 && j < (int)nPairs) { g[j].x = (int)v[j * 2]; g[j].y = (int)v[j * 2 + 1]; } else g[j].x = g[j].y = -1;
+			}
+		}
+	}
+	_ReleaseMatchData(md);
+}
+
+//Matches code against n subjects. Much faster than calling Cpp_RegexMatch for each subject from C#.
+//r receives results for each subject. Caller allocates n elements.
+//ovec, if not null, receives x=from and y=to of match and groups for each subject: ovecCount elements at ovec + i * ovecCount. Sets -1 if unset, not matched or partial, and for elements after the last group.
+//nThreads - max number of threads, including this thread. If >1 and there are many subjects, splits the work between threads.
+//Returns the number of matched subjects (not including partial).
+//errStr, if not null, receives error text of the first failed subject, except no match or partial match. Caller then must SysFreeString it.
+EXPORT int Cpp_RegexMatchBatch(pcre2_code_16* code, const RegexSubject* a, int n, UINT flags, RegexBatchResult* r,
+	POINT* ovec = null, int ovecCount = 0, int nThreads = 1, out BSTR* errStr = null)
+{
+	const int c_minPerThread = 2000; //the time of passing a work item to a pool thread and waking it is similar to the time of matching this many short strings
+	if(ovec == null || ovecCount <= 0) { ovec = null; ovecCount = 0; }
+	_Parallel(n, min(nThreads, n / c_minPerThread), [=](int from, int to) { _MatchBatch(code, a, from, to, flags, r, ovec, ovecCount); });
+
+	int R = 0;
+	for(int i = 0; i < n; i++) {
+		int k = r[i].result;
+		if(k > 0) R++;
+		else if(k < PCRE2_ERROR_PARTIAL && errStr != null) { *errStr = GetErrorMessage(k); errStr = null; }
+	}
 	return R;
 }
 
+//Cpp_RegexFindAllStart iterator.
+struct RegexFindAll {
+	pcre2_code_16* code; STR s; size_t len; UINT flags;
+	int(*callout)(pcre2_callout_block*, void*);
+	pcre2_match_data_16* md; //own, not t_md, because other matches can run in this thread between Cpp_RegexFindAllNext calls
+	UINT ovecCount;
+	bool utf, crlfIsNewline;
+	bool done;
+	size_t start; //offset for the next match
+	UINT options; //options for the next match: 0 or PCRE2_NOTEMPTY_ATSTART | PCRE2_ANCHORED after an empty match
+	CHeapPtr<POINT> vec; int vecCap; //results of the last Cpp_RegexFindAllNext
+};
+
+//Creates an iterator that finds all matches of code in s, starting at start. Then call Cpp_RegexFindAllNext until it returns <= 0, and finally Cpp_RegexFindAllEnd.
+//s must be valid until Cpp_RegexFindAllEnd.
+//The iterator uses the same algorithm as pcre2demo.c (and the C# regexp.FindAll): after an empty match it retries at the same offset with PCRE2_NOTEMPTY_ATSTART | PCRE2_ANCHORED; if it fails, it advances by 1 character, or by 2 at CRLF if CRLF is a newline.
+//Returns null if failed to allocate memory.
+EXPORT RegexFindAll* Cpp_RegexFindAllStart(pcre2_code_16* code, STR s, size_t len, size_t start = 0, UINT flags = 0,
+	int(*callout)(pcre2_callout_block*, void*) = null)
+{
+	auto f = new RegexFindAll();
+	f->md = pcre2_match_data_create_from_pattern_16(code, null);
+	if (f->md == null) { delete f; return null; }
+	f->code = code; f->s = s; f->len = len; f->flags = flags; f->callout = callout;
+	f->ovecCount = pcre2_get_ovector_count_16(f->md);
+	f->start = start;
+
+	UINT options = 0, newline = 0;
+	pcre2_pattern_info_16(code, PCRE2_INFO_ALLOPTIONS, &options);
+	pcre2_pattern_info_16(code, PCRE2_INFO_NEWLINE, &newline);
+	f->utf = options & PCRE2_UTF;
+	f->crlfIsNewline = newline == PCRE2_NEWLINE_ANY || newline == PCRE2_NEWLINE_CRLF || newline == PCRE2_NEWLINE_ANYCRLF;
+	return f;
+}
+
+//Finds next matches.
+//maxMatches - max number of matches to get in this call. If 0, gets all.
+//vec - receives an array of x=from and y=to of match and groups for each match, vecCount elements per match. Unset groups are -1.
+//	The array is owned by f. Valid until the next call.
+//Returns the number of matches in vec. Returns 0 if there are no more matches (also after a partial match). Returns <0 (PCRE2 error code) if failed (the matches found before the error are lost).
+//errStr, if not null, receives error text when fails. Caller then must SysFreeString it.
+EXPORT int Cpp_RegexFindAllNext(RegexFindAll* f, int maxMatches, out POINT*& vec, out int& vecCount, out BSTR* errStr = null)
+{
+	vec = null; vecCount = (int)f->ovecCount;
+	if (maxMatches <= 0) maxMatches = INT_MAX;
+	STR s = f->s; size_t len = f->len;
+	auto v = pcre2_get_ovector_pointer_16(f->md);
+	int n = 0;
+	while (n < maxMatches && !f->done) {
+		size_t start = f->start;
+		int R = pcre2_match_16(f->code, s, len, start, f->flags | f->options, f->md, null, f->callout);
+		if (R == PCRE2_ERROR_NOMATCH) {
+			if (f->options == 0) { f->done = true; break; }
+			//the previous match was empty and there is no non-empty match at the same offset. Advance by 1 character.
+			f->options = 0;
+			size_t i = start + 1;
+			if (f->crlfIsNewline && start + 1 < len && s[start] == '\r' && s[start + 1] == '\n') i++;
+			else if (f->utf) while (i < len && (s[i] & 0xfc00) == 0xdc00) i++;
+			f->start = i;
+			if (i > len) f->done = true;
+			continue;
+		}
+		if (R == PCRE2_ERROR_PARTIAL) { f->done = true; break; }
+		if (R < 0) {
+			f->done = true;
+			if (errStr != null) *errStr = GetErrorMessage(R);
+			return R;
+		}
+
+		//add the match to vec
+		int nv = (int)f->ovecCount;
+		if ((n + 1) * nv > f->vecCap) {
+			int cap = max(f->vecCap * 2, max(nv * 16, (n + 1) * nv));
+			if (!f->vec.Reallocate(cap)) { f->done = true; return PCRE2_ERROR_NOMEMORY; }
+			f->vecCap = cap;
+		}
+		POINT* g = f->vec + n * nv;
+		for (int i = 0; i < nv; i++) { g[i].x = (int)v[i * 2]; g[i].y = (int)v[i * 2 + 1]; }
+		n++;
+
+		//set f->start and f->options for the next match
+		f->options = 0;
+		f->start = v[1];
+		if (v[0] == v[1]) { //empty match. Try non-empty match at the same offset.
+			if (v[0] == len) f->done = true;
+			else f->options = PCRE2_NOTEMPTY_ATSTART | PCRE2_ANCHORED;
+		} else { //if \K in a lookbehind assertion, the match can end at the offset where it started. Advance, to avoid an infinite loop.
+			size_t startchar = pcre2_get_startchar_16(f->md);
+			if (f->start <= startchar) {
+				if (startchar >= len) f->done = true;
+				size_t i = startchar + 1;
+				if (f->utf) while (i < len && (s[i] & 0xfc00) == 0xdc00) i++;
+				f->start = i;
+			}
+		}
+	}
+	if (n > 0) vec = f->vec;
+	return n;
+}
+
+//Frees the iterator created by Cpp_RegexFindAllStart.
+EXPORT void Cpp_RegexFindAllEnd(RegexFindAll* f)
+{
+	if (f == null) return;
+	pcre2_match_data_free_16(f->md);
+	delete f;
+}
+
+struct RegexStream {
+	pcre2_code_16* code; UINT flags;
+	pcre2_match_data_16* md; //own, like RegexFindAll::md
+	UINT ovecCount;
+	bool utf, crlfIsNewline;
+	bool done;
+	size_t lookbehind; //code units to retain before the next match start: max lookbehind of code, at least 1 (for \b, (?m)^ etc)
+	CHeapPtr<WCHAR> buf; size_t bufLen, bufCap; //the retained tail of previous chunks + the new chunk
+	__int64 bufOffset; //offset of buf[0] in the stream
+	size_t start; //offset in buf for the next match
+	UINT options; //like RegexFindAll::options
+	CHeapPtr<RegexSpan> vec; int vecCap; //results of the last Cpp_RegexStreamFeed
+};
+
+//Creates a matcher that finds all matches of code in a subject that is passed in chunks, eg read from a file or pipe. Then call Cpp_RegexStreamFeed for each chunk, and finally Cpp_RegexStreamEnd.
+//Finds the same matches as Cpp_RegexFindAllStart with the whole subject. The matcher retains only the part of the subject needed for the next match: the text of a partial match at the end of the chunk (PCRE2_PARTIAL_HARD), and lookbehind.
+//Returns null if failed to allocate memory.
+EXPORT RegexStream* Cpp_RegexStreamStart(pcre2_code_16* code, UINT flags = 0)
+{
+	auto t = new RegexStream();
+	t->md = pcre2_match_data_create_from_pattern_16(code, null);
+	if (t->md == null) { delete t; return null; }
+	t->code = code; t->flags = flags;
+	t->ovecCount = pcre2_get_ovector_count_16(t->md);
+
+	UINT options = 0, newline = 0, lookbehind = 0;
+	pcre2_pattern_info_16(code, PCRE2_INFO_ALLOPTIONS, &options);
+	pcre2_pattern_info_16(code, PCRE2_INFO_NEWLINE, &newline);
+	pcre2_pattern_info_16(code, PCRE2_INFO_MAXLOOKBEHIND, &lookbehind);
+	t->utf = options & PCRE2_UTF;
+	t->crlfIsNewline = newline == PCRE2_NEWLINE_ANY || newline == PCRE2_NEWLINE_CRLF || newline == PCRE2_NEWLINE_ANYCRLF;
+	t->lookbehind = max(lookbehind, 1u) * (t->utf ? 2 : 1); //characters -> code units (surrogate pairs)
+	return t;
+}
+
+//Adds a chunk of the subject, and finds matches that don't depend on the next chunks.
+//last - s is the last chunk (can be empty). Then finds the remaining matches, and further calls return 0.
+//vec - receives an array of match and group offsets for each match, vecCount elements per match. The array is owned by t. Valid until the next call.
+//Returns the number of matches in vec. Returns <0 (PCRE2 error code) if failed; then further calls return 0.
+//errStr, if not null, receives error text when fails. Caller then must SysFreeString it.
+EXPORT int Cpp_RegexStreamFeed(RegexStream* t, STR s, size_t len, bool last, out RegexSpan*& vec, out int& vecCount, out BSTR* errStr = null)
+{
+	vec = null; vecCount = (int)t->ovecCount;
+	if (t->done) return 0;
+
+	//append s to the retained tail
+	if (t->bufLen + len > t->bufCap) {
+		size_t cap = max(t->bufCap * 2, t->bufLen + len);
+		if (!t->buf.Reallocate(cap)) { t->done = true; return PCRE2_ERROR_NOMEMORY; }
+		t->bufCap = cap;
+	}
+	if (len) memcpy(t->buf + t->bufLen, s, len * 2);
+	t->bufLen += len;
+
+	STR b = t->buf; size_t bLen = t->bufLen;
+	//if the last character is the first half of a surrogate pair, it can't be matched until the next chunk
+	if (t->utf && !last && bLen > t->start && (b[bLen - 1] & 0xfc00) == 0xd800) bLen--;
+
+	UINT flags = t->flags | (last ? 0 : PCRE2_PARTIAL_HARD) | (t->bufOffset ? PCRE2_NOTBOL : 0);
+	auto v = pcre2_get_ovector_pointer_16(t->md);
+	//When there is no match in b from start to i, the next search starts at the character before i, not at i, because PCRE skips the position between CR and LF only when it is not the start offset.
+	auto restart = [&](size_t start, size_t i) {
+		if (i > start && t->options == 0) {
+			i--;
+			if (i > start && ((t->utf && (b[i] & 0xfc00) == 0xdc00) || (t->crlfIsNewline && b[i] == '\n' && b[i - 1] == '\r'))) i--;
+		}
+		t->start = i;
+	};
+	int n = 0;
+	for (;;) {
+		size_t start = t->start;
+		if (start > bLen) break; //after \K at the end. Wait for the next chunk.
+		int R = pcre2_match_16(t->code, b, bLen, start, flags | t->options, t->md, null, null);
+		flags |= PCRE2_NO_UTF_CHECK; //checked by the first call
+		if (R == PCRE2_ERROR_NOMATCH) {
+			if (t->options == 0) { restart(start, bLen); break; }
+			//like Cpp_RegexFindAllNext. But if the next character is in the next chunk, wait for it.
+			if (start == bLen) break;
+			size_t i = start + 1;
+			if (t->crlfIsNewline && b[start] == '\r') {
+				if (i < bLen) { if (b[i] == '\n') i++; } else if (!last) break;
+			} else if (t->utf) while (i < bLen && (b[i] & 0xfc00) == 0xdc00) i++;
+			t->options = 0;
+			t->start = i;
+			continue;
+		}
+		if (R == PCRE2_ERROR_PARTIAL) { restart(start, v[0]); break; } //need more text. When last, a partial match is not possible.
+		if (R < 0) {
+			t->done = true;
+			if (errStr != null) *errStr = GetErrorMessage(R);
+			return R;
+		}
+
+		//an empty match at the end can depend on the next chunk (eg \b, (?m)^), but PCRE2_PARTIAL_HARD does not return partial for it
+		if (v[0] == bLen && v[1] == bLen && !last) { restart(start, bLen); break; }
+
+		int nv = (int)t->ovecCount;
+		if ((n + 1) * nv > t->vecCap) {
+			int cap = max(t->vecCap * 2, max(nv * 16, (n + 1) * nv));
+			if (!t->vec.Reallocate(cap)) { t->done = true; return PCRE2_ERROR_NOMEMORY; }
+			t->vecCap = cap;
+		}
+		RegexSpan* g = t->vec + n * nv;
+		for (int i = 0; i < nv; i++) {
+			auto x = v[i * 2], y = v[i * 2 + 1];
+			g[i].start = x == PCRE2_UNSET ? -1 : t->bufOffset + (__int64)x;
+			g[i].end = y == PCRE2_UNSET ? -1 : t->bufOffset + (__int64)y;
+		}
+		n++;
+
+		t->options = 0;
+		t->start = v[1];
+		if (v[0] == v[1]) {
+			if (v[0] == bLen && last) break;
+			t->options = PCRE2_NOTEMPTY_ATSTART | PCRE2_ANCHORED;
+		} else {
+			size_t startchar = pcre2_get_startchar_16(t->md);
+			if (t->start <= startchar) {
+				size_t i = startchar + 1;
+				if (t->utf) while (i < bLen && (b[i] & 0xfc00) == 0xdc00) i++;
+				t->start = i;
+			}
+		}
+	}
+
+	if (last) {
+		t->done = true;
+	} else { //retain only the text from the next match start, and lookbehind
+		size_t keep = t->start > t->lookbehind ? t->start - t->lookbehind : 0;
+		if (keep > 0) {
+			memmove(t->buf, t->buf + keep, (t->bufLen - keep) * 2);
+			t->bufLen -= keep; t->start -= keep; t->bufOffset += keep;
+		}
+	}
+	if (n > 0) vec = t->vec;
+	return n;
+}
+
+//Frees the matcher created by Cpp_RegexStreamStart.
+EXPORT void Cpp_RegexStreamEnd(RegexStream* t)
+{
+	if (t == null) return;
+	pcre2_match_data_free_16(t->md);
+	delete t;
+}
+
 //Calls pcre2_match_16 and returns true if it returns >0.
-//Allocates/frees match data in a fast way.
+//Uses thread-local match data (does not allocate memory).
 //This version is used in this dll, eg by Wildex.
 bool Match(pcre2_code_16* code, STR s, size_t len, size_t start, UINT flags)
 {
-	pcre2_match_data_16* md;
-#ifdef FAST_MD
-	md = pcre2_match_data_create_from_pattern_16(code, _GetGC());
-#else
-	md = pcre2_match_data_create_from_pattern_16(code, null);
-#endif
+	UINT ovecCount;
+	auto md = _GetMatchData(code, ovecCount);
 
 	int R = pcre2_match_16(code, s, len, start, flags, md, null, null);
 
-	pcre2_match_data_free_16(md);
+	_ReleaseMatchData(md);
 
 	return R > 0 || R == PCRE2_ERROR_PARTIAL;
 }
+
+#pragma region regex cache
+
+//Serialized regex cache: _RxCacheHeader, then n _RxCacheKey (each aligned to 8 bytes), then pcre2_serialize_encode_16 data.
+struct _RxCacheHeader {
+	DWORD magic; //c_rxCacheMagic
+	DWORD config; //_RxCacheConfig()
+	DWORD checksum; //of keys and code
+	int n; //number of regular expressions
+	DWORD keysSize; //size of keys in bytes
+	DWORD codeSize; //size of pcre2_serialize_encode_16 data
+};
+
+struct _RxCacheKey { __int64 flags; int len; WCHAR rx[1]; };
+
+static const DWORD c_rxCacheMagic = 0x43585241; //"ARXC"
+
+//Change when changed something that affects compiled code but is not in _RxCacheConfig, eg Compile adds flags or PCRE code modifications (//au).
+static const DWORD c_rxCacheFormat = 1;
+
+static size_t _RxCacheKeySize(size_t len) { return (offsetof(_RxCacheKey, rx) + len * 2 + 7) & ~(size_t)7; }
+
+static DWORD _RxCacheHash(const void* data, size_t size, DWORD h = 2166136261) {
+	for(size_t i = 0; i < size; i++) h = (h ^ ((const BYTE*)data)[i]) * 16777619;
+	return h;
+}
+
+//Returns hash of c_rxCacheFormat, PCRE version and PCRE build config that affects compiled code.
+//Serialized code created with another config cannot be used.
+static DWORD _RxCacheConfig() {
+	static DWORD s_config; //info: race is benign
+	if(s_config == 0) {
+		UINT a[10] = { c_rxCacheFormat, PCRE2_MAJOR, PCRE2_MINOR, sizeof(void*) };
+		pcre2_config_16(PCRE2_CONFIG_BSR, a + 4);
+		pcre2_config_16(PCRE2_CONFIG_LINKSIZE, a + 5);
+		pcre2_config_16(PCRE2_CONFIG_NEWLINE, a + 6);
+		pcre2_config_16(PCRE2_CONFIG_PARENSLIMIT, a + 7);
+		pcre2_config_16(PCRE2_CONFIG_NEVER_BACKSLASH_C, a + 8);
+		pcre2_config_16(PCRE2_CONFIG_UNICODE, a + 9);
+		WCHAR uv[24] = {}; //Unicode version, like "15.0.0"
+		pcre2_config_16(PCRE2_CONFIG_UNICODE_VERSION, uv);
+		s_config = _RxCacheHash(uv, sizeof(uv), _RxCacheHash(a, sizeof(a))) | 1;
+	}
+	return s_config;
+}
+
+//Regular expressions loaded by Cpp_RegexCacheLoad.
+struct RegexCache {
+	int n;
+	CHeapPtr<pcre2_code_16*> codes; //decoded by pcre2_serialize_decode_16
+	CHeapPtr<BYTE> keys; //copy of serialized _RxCacheKey array
+	CHeapPtr<_RxCacheKey*> k; //pointers to keys
+
+	~RegexCache() {
+		if(codes) for(int i = 0; i < n; i++) pcre2_code_free_16(codes[i]);
+	}
+};
+
+//Serializes n regular expressions compiled by Cpp_RegexCompile, to use later with Cpp_RegexCacheLoad, eg in other processes.
+//The pattern text and flags of each item are the keys for Cpp_RegexCacheGet. The code must be created with these rx and flags.
+//Returns binary data (BSTR with SysStringByteLen size), which caller can save in a file. Returns null if failed.
+//errStr, if not null, receives error text when fails. Caller then must SysFreeString it.
+EXPORT BSTR Cpp_RegexCacheSerialize(const RegexCacheItem* a, int n, out BSTR* errStr = null)
+{
+	if(n <= 0) return null;
+	Buffer<const pcre2_code_16*, 64> codes(n);
+	size_t keysSize = 0;
+	for(int i = 0; i < n; i++) {
+		codes[i] = a[i].code;
+		keysSize += _RxCacheKeySize(a[i].len);
+	}
+
+	uint8_t* code = null; PCRE2_SIZE codeSize = 0;
+	int r = pcre2_serialize_encode_16(codes, n, &code, &codeSize, null);
+	if(r < 0) {
+		if(errStr != null) *errStr = GetErrorMessage(r);
+		return null;
+	}
+
+	//BSTR data is not 8-byte aligned. Create keys in a buffer.
+	Buffer<__int64, 256> keys; keys.AllocAndZero(keysSize / 8);
+	LPBYTE p = (LPBYTE)(__int64*)keys;
+	for(int i = 0; i < n; i++) {
+		auto k = (_RxCacheKey*)p;
+		k->flags = a[i].flags;
+		k->len = (int)a[i].len;
+		memcpy(k->rx, a[i].rx, a[i].len * 2);
+		p += _RxCacheKeySize(a[i].len);
+	}
+
+	size_t size = sizeof(_RxCacheHeader) + keysSize + codeSize;
+	BSTR R = SysAllocStringByteLen(null, (UINT)size);
+	if(R != null) {
+		auto h = (_RxCacheHeader*)R;
+		memcpy(h + 1, keys, keysSize);
+		memcpy((LPBYTE)(h + 1) + keysSize, code, codeSize);
+		h->magic = c_rxCacheMagic;
+		h->config = _RxCacheConfig();
+		h->n = n;
+		h->keysSize = (DWORD)keysSize;
+		h->codeSize = (DWORD)codeSize;
+		h->checksum = _RxCacheHash(h + 1, keysSize + codeSize);
+	}
+	pcre2_serialize_free_16(code);
+	return R;
+}
+
+//Loads regular expressions serialized by Cpp_RegexCacheSerialize. Then call Cpp_RegexCacheGet to get them, and finally Cpp_RegexCacheFree.
+//Returns null if data is invalid or created with another PCRE version or build config.
+//data is not used after this call.
+EXPORT RegexCache* Cpp_RegexCacheLoad(const BYTE* data, size_t size)
+{
+	auto h = (const _RxCacheHeader*)data;
+	if(size < sizeof(_RxCacheHeader) || h->magic != c_rxCacheMagic || h->config != _RxCacheConfig() || h->n <= 0
+		|| sizeof(_RxCacheHeader) + (size_t)h->keysSize + h->codeSize != size
+		|| h->checksum != _RxCacheHash(h + 1, size - sizeof(_RxCacheHeader))) return null;
+
+	int n = h->n;
+	auto c = new RegexCache();
+	if(!c->keys.Allocate(h->keysSize) || !c->k.Allocate(n) || !c->codes.Allocate(n)) { delete c; return null; }
+	memcpy(c->keys, h + 1, h->keysSize);
+	for(size_t i = 0, offs = 0; i < (size_t)n; i++) {
+		auto k = (_RxCacheKey*)(c->keys + offs);
+		if(offs + offsetof(_RxCacheKey, rx) > h->keysSize || k->len < 0 || offs + _RxCacheKeySize(k->len) > h->keysSize) { delete c; return null; }
+		c->k[i] = k;
+		offs += _RxCacheKeySize(k->len);
+	}
+
+	int r = pcre2_serialize_decode_16(c->codes, n, (const uint8_t*)(h + 1) + h->keysSize, null);
+	if(r != n) { //pcre2_serialize_decode_16 validates PCRE version and config too
+		c->n = max(r, 0);
+		delete c;
+		return null;
+	}
+	c->n = n;
+	return c;
+}
+
+//Calls Cpp_RegexCacheLoad with data of a file created from Cpp_RegexCacheSerialize data. Uses a memory-mapped view of the file.
+//Returns null if the file does not exist or is invalid.
+EXPORT RegexCache* Cpp_RegexCacheOpen(STR file)
+{
+	HANDLE hf = CreateFileW(file, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, null, OPEN_EXISTING, 0, null);
+	if(hf == INVALID_HANDLE_VALUE) return null;
+	RegexCache* R = null;
+	LARGE_INTEGER size;
+	if(GetFileSizeEx(hf, &size) && size.QuadPart > 0 && size.QuadPart < 0x10000000) {
+		HANDLE hm = CreateFileMappingW(hf, null, PAGE_READONLY, 0, 0, null);
+		if(hm != null) {
+			auto p = (const BYTE*)MapViewOfFile(hm, FILE_MAP_READ, 0, 0, 0);
+			if(p != null) {
+				R = Cpp_RegexCacheLoad(p, (size_t)size.QuadPart);
+				UnmapViewOfFile(p);
+			}
+			CloseHandle(hm);
+		}
+	}
+	CloseHandle(hf);
+	return R;
+}
+
+//Finds a regular expression in c by pattern text and flags (the same as passed to Cpp_RegexCompile).
+//If found, returns its copy, and codeSize receives its size. Use it like the return value of Cpp_RegexCompile; finally free with Cpp_RegexDtor.
+//Returns null if not found. Then call Cpp_RegexCompile.
+EXPORT pcre2_code_16* Cpp_RegexCacheGet(RegexCache* c, STR rx, size_t len, __int64 flags, out int& codeSize)
+{
+	codeSize = 0;
+	if(c == null) return null;
+	for(int i = 0; i < c->n; i++) {
+		auto k = c->k[i];
+		if(k->flags != flags || k->len != (int)len || memcmp(k->rx, rx, len * 2) != 0) continue;
+		//Not pcre2_code_copy_16. Its copy would share the decoded tables with a non-atomic reference count, but C# can free codes in other threads.
+		auto code = pcre2_code_copy_with_tables_16(c->codes[i]);
+		if(code == null) return null;
+		size_t z = 0;
+		pcre2_pattern_info_16(code, PCRE2_INFO_SIZE, &z);
+		codeSize = (int)z;
+		return code;
+	}
+	return null;
+}
+
+//Frees c created by Cpp_RegexCacheLoad or Cpp_RegexCacheOpen. Codes returned by Cpp_RegexCacheGet remain valid.
+EXPORT void Cpp_RegexCacheFree(RegexCache* c)
+{
+	delete c;
+}
+
+#pragma endregion
 }
 
 #pragma region Wildex
 
+//Used for WildType::Multi to match all Text and Wildcard parts in one pass, when there are many such parts.
+//Text parts: hash table. The hash is of lowercase text, therefore can be used for case-sensitive parts too.
+//Wildcard parts: Aho-Corasick automaton for the longest literal part (anchor) of each part. Then calls _MatchWildcard only for parts whose anchor is in the string.
+//The automaton also uses lowercase text. Parts without an anchor (eg "*" or "?*") are always matched with _MatchWildcard.
+//Thread-safe (read-only after Create).
+struct Wildex::_MultiIndex {
+	static const int c_minParts = 4; //don't create if there are less Text and Wildcard parts. Then Match is fast enough.
+
+	const Wildex* _parts;
+	int _count;
+	BYTE* _indexed; //for each part: 1 Text, 2 Wildcard with anchor, 3 Wildcard without anchor, 0 other (call Match)
+
+	//hash table of Text parts
+	int* _buckets; //part index, or -1
+	int* _next; //for each part, next part index in the same bucket, or -1
+	UINT _bucketMask;
+
+	//Aho-Corasick automaton of Wildcard anchors. State 0 is root.
+	struct _Edge { unsigned __int64 key; int state; }; //key is (state << 16 | char) + 1, or 0 if empty
+	std::vector<_Edge> _edges; //open addressing hash table
+	UINT _edgeMask;
+	std::vector<int> _fail, _dict, _out; //for each state: failure link; nearest failure-chain state with output, or 0; the first part, or -1
+	std::vector<int> _outNext; //for each part, next part ending in the same state, or -1
+	bool _anyWild;
+
+	static UINT _Hash(STR s, size_t len) {
+		UINT h = 2166136261; //FNV-1a
+		for(size_t i = 0; i < len; i++) h = (h ^ _LowerChar(s[i])) * 16777619;
+		return h;
+	}
+
+	static UINT _EdgeHash(unsigned __int64 key) { return (UINT)((key * 0x9E3779B97F4A7C15ull) >> 32); }
+
+	int _Goto(int state, WCHAR c) const {
+		unsigned __int64 key = ((unsigned __int64)state << 16 | c) + 1;
+		for(UINT i = _EdgeHash(key) & _edgeMask; ; i = (i + 1) & _edgeMask) {
+			const _Edge& e = _edges[i];
+			if(e.key == key) return e.state;
+			if(e.key == 0) return -1;
+		}
+	}
+
+	void _AddEdge(int state, WCHAR c, int to) {
+		unsigned __int64 key = ((unsigned __int64)state << 16 | c) + 1;
+		UINT i = _EdgeHash(key) & _edgeMask;
+		while(_edges[i].key != 0) i = (i + 1) & _edgeMask;
+		_edges[i] = { key, to };
+	}
+
+	_MultiIndex() { _buckets = _next = null; _indexed = null; _bucketMask = 0; _anyWild = false; }
+
+	~_MultiIndex() {
+		delete[] _indexed;
+		delete[] _buckets;
+		delete[] _next;
+	}
+
+	//Returns null if don't need.
+	static _MultiIndex* Create(const Wildex* a, int count) {
+		int nText = 0, nWild = 0, anchorChars = 0;
+		for(int i = 0; i < count; i++) {
+			auto& w = a[i];
+			if(w._type == WildType::Text) nText++;
+			else if(w._type == WildType::Wildcard) nWild++, anchorChars += _Anchor(w).anchorLen;
+		}
+		if(nText + nWild < c_minParts) return null;
+
+		auto x = new _MultiIndex();
+		x->_parts = a; x->_count = count;
+		x->_indexed = new BYTE[count];
+
+		if(nText > 0) {
+			UINT nb = 4; while(nb < (UINT)nText * 2) nb <<= 1;
+			x->_bucketMask = nb - 1;
+			x->_buckets = new int[nb]; for(UINT i = 0; i < nb; i++) x->_buckets[i] = -1;
+			x->_next = new int[count];
+		}
+
+		UINT ne = 16; while(ne < (UINT)anchorChars * 2) ne <<= 1;
+		x->_edgeMask = ne - 1;
+		x->_edges.resize(ne);
+		x->_out.push_back(-1);
+		x->_outNext.resize(count, -1);
+		std::vector<std::vector<std::pair<WCHAR, int>>> children(1);
+
+		for(int i = 0; i < count; i++) {
+			auto& w = a[i];
+			x->_indexed[i] = 0;
+			if(w._type == WildType::Text) {
+				x->_indexed[i] = 1;
+				int& b = x->_buckets[_Hash(w._text, w._text_length) & x->_bucketMask];
+				x->_next[i] = b; b = i;
+			} else if(w._type == WildType::Wildcard) {
+				auto& g = _Anchor(w);
+				if(g.anchorLen == 0) { x->_indexed[i] = 3; continue; }
+				x->_indexed[i] = 2;
+				x->_anyWild = true;
+				STR t = w._text + g.start + g.anchor;
+				int state = 0;
+				for(int j = 0; j < g.anchorLen; j++) {
+					WCHAR c = _LowerChar(t[j]);
+					int k = x->_Goto(state, c);
+					if(k < 0) {
+						k = (int)x->_out.size();
+						x->_out.push_back(-1);
+						children.emplace_back();
+						children[state].push_back({ c, k });
+						x->_AddEdge(state, c, k);
+					}
+					state = k;
+				}
+				x->_outNext[i] = x->_out[state]; x->_out[state] = i;
+			}
+		}
+
+		//failure and dictionary links, breadth-first
+		int nStates = (int)x->_out.size();
+		x->_fail.resize(nStates); x->_dict.resize(nStates);
+		std::vector<int> queue; queue.reserve(nStates); queue.push_back(0);
+		for(size_t q = 0; q < queue.size(); q++) {
+			int u = queue[q];
+			for(auto& [c, v] : children[u]) {
+				int f = 0;
+				if(u != 0) {
+					for(f = x->_fail[u]; ; f = x->_fail[f]) {
+						int k = x->_Goto(f, c);
+						if(k >= 0) { f = k; break; }
+						if(f == 0) break;
+					}
+				}
+				x->_fail[v] = f;
+				x->_dict[v] = x->_out[f] >= 0 ? f : x->_dict[f];
+				queue.push_back(v);
+			}
+		}
+
+		return x;
+	}
+
+	//Gets the Wildcard part's segment with the longest anchor.
+	static const _WildSeg& _Anchor(const Wildex& w) {
+		auto& p = *w._wild;
+		int r = 0;
+		for(int i = 1; i < p.nSeg; i++) if(p.seg[i].anchorLen > p.seg[r].anchorLen) r = i;
+		return p.seg[r];
+	}
+
+	//For each indexed part sets hit[i] = 1 if the part matches (without its option n applied).
+	void Match(STR s, size_t lenS, BYTE* hit) const {
+		if(_bucketMask) {
+			for(int i = _buckets[_Hash(s, lenS) & _bucketMask]; i >= 0; i = _next[i]) {
+				auto& w = _parts[i];
+				if(Equals(s, lenS, w._text, w._text_length, w._ignoreCase)) hit[i] = 1;
+			}
+		}
+
+		if(_anyWild) {
+			for(size_t j = 0, state = 0; j < lenS; j++) {
+				WCHAR c = _LowerChar(s[j]);
+				for(;;) {
+					int k = _Goto((int)state, c);
+					if(k >= 0) { state = k; break; }
+					if(state == 0) break;
+					state = _fail[state];
+				}
+				for(int t = _out[state] >= 0 ? (int)state : _dict[state]; t != 0; t = _dict[t]) {
+					for(int i = _out[t]; i >= 0; i = _outNext[i]) hit[i] = 2; //candidate
+				}
+			}
+		}
+
+		for(int i = 0; i < _count; i++) {
+			if(hit[i] == 2 || _indexed[i] == 3) hit[i] = _parts[i]._MatchWildcard(s, lenS);
+		}
+	}
+
+	bool IsIndexed(int i) const { return _indexed[i] != 0; }
+};
+
+//Cache of parsed wildcard expressions, for ParseCached. Entry of the cache, and the cache (static members).
+//Entries are reference-counted. The cache holds 1 reference, and each Wildex created by ParseCached holds 1.
+//	If an entry is evicted while Wildex variables use it, it is deleted when the last of them is destroyed.
+//Thread-safe. The parsed Wildex is read-only, therefore can be used by multiple threads.
+struct Wildex::_CacheEntry {
+	static const int c_capacity = 256; //max count of entries. When more, evicts the least recently used.
+	static const int c_maxLength = 2000; //don't add longer expressions to the cache
+	static const int c_nBuckets = 512;
+
+	Wildex x; //parsed from text
+	LPWSTR text; //own copy of the wildcard expression. Parts of Multi point into it.
+	int len;
+	UINT hash;
+	long refs;
+	_CacheEntry *prev, *next; //LRU list. s_head is the most recently used.
+	_CacheEntry* nextInBucket;
+
+	static SRWLOCK s_lock;
+	static _CacheEntry* s_buckets[c_nBuckets];
+	static _CacheEntry *s_head, *s_tail;
+	static int s_count;
+	static __int64 s_hits, s_misses;
+
+	_CacheEntry(STR w, size_t lenW, UINT h) : len((int)lenW), hash(h), refs(1), prev(null), next(null), nextInBucket(null) {
+		text = (LPWSTR)malloc((lenW + 1) * 2); memcpy(text, w, lenW * 2); text[lenW] = 0;
+	}
+
+	~_CacheEntry() { free(text); } //info: x does not use text in dtor
+
+	void AddRef() { InterlockedIncrement(&refs); }
+
+	void Release() { if(0 == InterlockedDecrement(&refs)) delete this; }
+
+	static UINT _Hash(STR w, size_t lenW) {
+		UINT h = 2166136261; //FNV-1a
+		for(size_t i = 0; i < lenW; i++) h = (h ^ w[i]) * 16777619;
+		return h;
+	}
+
+	//Call when locked.
+	static _CacheEntry* _Find(STR w, size_t lenW, UINT h) {
+		for(auto e = s_buckets[h % c_nBuckets]; e != null; e = e->nextInBucket) {
+			if(e->hash == h && e->len == (int)lenW && 0 == memcmp(e->text, w, lenW * 2)) return e;
+		}
+		return null;
+	}
+
+	//Call when locked.
+	void _Unlink() {
+		if(prev) prev->next = next; else s_head = next;
+		if(next) next->prev = prev; else s_tail = prev;
+		prev = next = null;
+	}
+
+	//Call when locked.
+	void _LinkFirst() {
+		next = s_head; prev = null;
+		if(s_head) s_head->prev = this; else s_tail = this;
+		s_head = this;
+	}
+
+	//Call when locked. Removes the least recently used entry from the cache and returns it. The caller must Release it when unlocked.
+	static _CacheEntry* _Evict() {
+		auto e = s_tail;
+		e->_Unlink();
+		for(auto* p = &s_buckets[e->hash % c_nBuckets]; *p != null; p = &(*p)->nextInBucket) {
+			if(*p == e) { *p = e->nextInBucket; break; }
+		}
+		s_count--;
+		return e;
+	}
+
+	//Finds wildcard expression w in the cache, or parses and adds to the cache.
+	//Returns entry with 1 reference for the caller. On error sets errStr (if not null) and returns null.
+	static _CacheEntry* Get(STR w, size_t lenW, out BSTR* errStr) {
+		UINT h = _Hash(w, lenW);
+		bool cache = lenW <= c_maxLength;
+		if(cache) {
+			AcquireSRWLockExclusive(&s_lock);
+			auto e = _Find(w, lenW, h);
+			if(e) {
+				s_hits++;
+				e->_Unlink(); e->_LinkFirst();
+				e->AddRef();
+			} else s_misses++;
+			ReleaseSRWLockExclusive(&s_lock);
+			if(e) return e;
+		}
+
+		//parse when unlocked, because can be slow, eg regex
+		auto e = new _CacheEntry(w, lenW, h);
+		if(!e->x.Parse(e->text, lenW, true, errStr)) { e->Release(); return null; }
+		if(!cache) return e;
+
+		_CacheEntry* release = null;
+		AcquireSRWLockExclusive(&s_lock);
+		if(auto e2 = _Find(w, lenW, h)) { //another thread added it meanwhile
+			e2->AddRef();
+			release = e; e = e2;
+		} else {
+			e->AddRef();
+			auto& b = s_buckets[h % c_nBuckets];
+			e->nextInBucket = b; b = e;
+			e->_LinkFirst();
+			if(++s_count > c_capacity) release = _Evict();
+		}
+		ReleaseSRWLockExclusive(&s_lock);
+		if(release) release->Release();
+		return e;
+	}
+};
+
+SRWLOCK Wildex::_CacheEntry::s_lock = SRWLOCK_INIT;
+Wildex::_CacheEntry* Wildex::_CacheEntry::s_buckets[c_nBuckets];
+Wildex::_CacheEntry* Wildex::_CacheEntry::s_head;
+Wildex::_CacheEntry* Wildex::_CacheEntry::s_tail;
+int Wildex::_CacheEntry::s_count;
+__int64 Wildex::_CacheEntry::s_hits, Wildex::_CacheEntry::s_misses;
+
 Wildex::~Wildex()
 {
+	if(_cached != null) {
+		_cached->Release();
+		_cached = null;
+		_text = null;
+		_wild = null;
+		return;
+	}
 	if(_text != null) {
 		switch(_type) {
-		case WildType::RegexPcre: pcre::Free(_regex); break;
-		case WildType::Multi: delete[] _multi_array; break;
-		default: if(_freeText) free(_text);
+		case WildType::RegexPcre: pcre::Free(_regex); free(_rxFilter); break;
+		case WildType::Multi: delete[] _multi_array; delete _multiIndex; break;
+		default:
+			if(_freeText) free(_text);
+			if(_wild != null) free(_wild);
 		}
 		_text = null;
+		_wild = null;
 	}
 }
 
@@ -427,6 +1676,7 @@ bool Wildex::Parse(STR w, size_t lenW, bool dontCopyString/* = false*/, out BSTR
 		case WildType::RegexPcre: {
 			_regex = pcre::Compile(w, lenW, _ignoreCase ? PCRE2_CASELESS : 0, out errStr);
 			if(_regex == null) return false;
+			_CreateRegexFilter(w, lenW);
 		} goto gr;
 		case WildType::Multi: {
 			int count = 1; auto eos = w + lenW; auto splitChar = split[0];
@@ -443,6 +1693,7 @@ bool Wildex::Parse(STR w, size_t lenW, bool dontCopyString/* = false*/, out BSTR
 				}
 				if(!_multi_array[i].Parse(wi, w - wi, true, out errStr)) return false;
 			}
+			_multiIndex = _MultiIndex::Create(_multi_array, count);
 		} goto gr;
 		}
 	}
@@ -454,10 +1705,35 @@ bool Wildex::Parse(STR w, size_t lenW, bool dontCopyString/* = false*/, out BSTR
 		_freeText = true;
 	}
 	_text_length = (int)lenW;
+	if(_type == WildType::Wildcard) _CompileWildcard();
 gr:
 	return true;
 }
 
+//Like Parse, but gets the parsed expression from a cache, or parses and adds to the cache.
+//Use when the same expressions are parsed frequently, eg by AccFinder in a wait loop. Then does not parse/compile again, eg regex.
+//The cache key is all the expression text, including "**options ". The caller does not have to keep w valid.
+//Call once (asserts).
+bool Wildex::ParseCached(STR w, size_t lenW, out BSTR* errStr/* = null*/)
+{
+	assert(_text == null);
+	auto e = _CacheEntry::Get(w, lenW, errStr);
+	if(e == null) return false;
+	memcpy((void*)this, &e->x, sizeof(Wildex));
+	_cached = e;
+	return true;
+}
+
+//Gets ParseCached statistics: the number of times an expression was found in the cache, was not found, and the number of cached expressions.
+/*static*/ void Wildex::CacheStats(out __int64& hits, out __int64& misses, out int& count)
+{
+	AcquireSRWLockShared(&_CacheEntry::s_lock);
+	hits = _CacheEntry::s_hits;
+	misses = _CacheEntry::s_misses;
+	count = _CacheEntry::s_count;
+	ReleaseSRWLockShared(&_CacheEntry::s_lock);
+}
+
 bool Wildex::Match(STR s, size_t lenS) const
 {
 	if(s == null) return false;
@@ -465,34 +1741,294 @@ bool Wildex::Match(STR s, size_t lenS) const
 	bool R = false;
 	switch(_type) {
 	case WildType::Wildcard:
-		R = Like(s, lenS, _text, _text_length, _ignoreCase);
+		R = _MatchWildcard(s, lenS);
 		break;
 	case WildType::Text:
 		R = Equals(s, lenS, _text, _text_length, _ignoreCase);
 		break;
 	case WildType::RegexPcre:
-		R = pcre::Match(_regex, s, lenS);
+		R = _RegexFilterMatch(s, lenS) && pcre::Match(_regex, s, lenS);
 		break;
 	case WildType::Multi:
-		//[n] parts: all must match (with their option n applied)
-		int nNot = 0;
-		for(int i = 0; i < _multi_count; i++) {
-			Wildex& w = _multi_array[i];
-			if(w._not) {
-				if(!w.Match(s, lenS)) return _not; //!v->Match(s) means 'matches if without option n applied'
-				nNot++;
+		R = _MatchMulti(s, lenS);
+		break;
+	}
+	return R ^ _not;
+}
+
+//Returns true if matches, without _not applied.
+bool Wildex::_MatchMulti(STR s, size_t lenS) const
+{
+	Buffer<BYTE, 100> hit;
+	if(_multiIndex) {
+		memset(hit.Alloc(_multi_count), 0, _multi_count);
+		_multiIndex->Match(s, lenS, hit);
+	}
+
+	//if part is indexed, the match result is in hit[i]. Else call Match.
+	auto match = [&](int i) { return _multiIndex && _multiIndex->IsIndexed(i) ? hit[i] != 0 : _multi_array[i].Match(s, lenS) ^ _multi_array[i]._not; };
+
+	//[n] parts: all must match (with their option n applied)
+	int nNot = 0;
+	for(int i = 0; i < _multi_count; i++) {
+		if(_multi_array[i]._not) {
+			if(match(i)) return false;
+			nNot++;
+		}
+	}
+	if(nNot == _multi_count) return true; //there are no parts without option n
+
+	//non-[n] parts: at least one must match
+	for(int i = 0; i < _multi_count; i++) {
+		if(!_multi_array[i]._not && match(i)) return true;
+	}
+	return false;
+}
+
+//Splits _text into segments separated by '*' and creates _wild.
+//Empty segments between "**" are not added. The first and last segments are always added (can be empty).
+void Wildex::_CompileWildcard()
+{
+	STR w = _text; int lenW = _text_length;
+	int nStars = (int)std::count(w, w + lenW, '*');
+	auto p = (_WildProg*)malloc(sizeof(_WildProg) + nStars * sizeof(_WildSeg));
+	int n = 0, minLen = 0;
+	for(int i = 0, start = 0; i <= lenW; i++) {
+		if(i < lenW && w[i] != '*') continue;
+		int len = i - start;
+		if(len > 0 || start == 0 || i == lenW) {
+			_WildSeg& g = p->seg[n++];
+			g.start = start; g.len = len;
+			g.anchor = start; g.anchorLen = 0;
+			for(int j = start, k; j < i; j = k + 1) { //find the longest part without '?'
+				for(k = j; k < i && w[k] != '?'; k++) {}
+				if(k - j > g.anchorLen) { g.anchor = j; g.anchorLen = k - j; }
+			}
+			g.anchor -= start;
+			minLen += len;
+		}
+		start = i + 1;
+	}
+	p->nSeg = n;
+	p->minLen = minLen;
+	_wild = p;
+}
+
+//Compares string s with segment g of wildcard expression w. The length of s must be >= g.len.
+/*static*/ bool Wildex::_WildSegEquals(STR s, STR w, const _WildSeg& g, bool ignoreCase)
+{
+	w += g.start;
+	if(g.anchorLen == g.len) {
+		if(!ignoreCase) return 0 == memcmp(s, w, g.len * 2);
+		return Equals(w, g.len, s, g.len, true);
+	}
+	for(int i = 0; i < g.len; i++) {
+		size_t cS = s[i], cW = w[i];
+		if(cW == cS || cW == '?') continue;
+		if(!ignoreCase || _LowerChar(cW) != _LowerChar(cS)) return false;
+	}
+	return true;
+}
+
+//Finds the leftmost match of segment g of wildcard expression w in string s of length lenS.
+//Returns 0-based index or -1.
+/*static*/ int Wildex::_WildSegFind(STR s, size_t lenS, STR w, const _WildSeg& g, bool ignoreCase)
+{
+	if((size_t)g.len > lenS) return -1;
+	if(g.anchorLen == 0) return 0; //only '?'
+	if(g.anchorLen == g.len) return Find(s, lenS, w + g.start, g.len, ignoreCase);
+
+	//find the anchor, then compare the whole segment
+	size_t last = lenS - g.len; //the last possible segment position
+	for(size_t i = 0; i <= last; i++) {
+		int k = Find(s + i + g.anchor, last - i + g.anchorLen, w + g.start + g.anchor, g.anchorLen, ignoreCase);
+		if(k < 0) break;
+		i += k;
+		if(_WildSegEquals(s + i, w, g, ignoreCase)) return (int)i;
+	}
+	return -1;
+}
+
+//Creates _rxFilter for regular expression rx. Call after compiling it (_regex).
+//Finds the longest literal substring that must be in any match, eg "dialog" in "^Save.*dialog$". Also if it must be at the start or end of string.
+//	The analysis is simple and conservative. Uses only literal characters not in groups and classes. Stops at top-level alternatives, inline options etc.
+//	If not found, uses the required first or last character (PCRE2_INFO_FIRSTCODEUNIT, PCRE2_INFO_LASTCODEUNIT).
+//Also gets PCRE2_INFO_MINLENGTH. Does not create _rxFilter if nothing useful found.
+void Wildex::_CreateRegexFilter(STR rx, size_t len)
+{
+	UINT minLen = 0, options = 0, firstType = 0, lastType = 0, firstUnit = 0, lastUnit = 0;
+	pcre2_pattern_info_16(_regex, PCRE2_INFO_MINLENGTH, &minLen);
+	pcre2_pattern_info_16(_regex, PCRE2_INFO_ALLOPTIONS, &options);
+	pcre2_pattern_info_16(_regex, PCRE2_INFO_FIRSTCODETYPE, &firstType);
+	pcre2_pattern_info_16(_regex, PCRE2_INFO_FIRSTCODEUNIT, &firstUnit);
+	pcre2_pattern_info_16(_regex, PCRE2_INFO_LASTCODETYPE, &lastType);
+	pcre2_pattern_info_16(_regex, PCRE2_INFO_LASTCODEUNIT, &lastUnit);
+
+	//With PCRE2_UTF or PCRE2_UCP, caseless matching uses Unicode case folding, eg 'k' matches KELVIN SIGN, 's' matches LATIN SMALL LETTER LONG S.
+	//	Our lowercase table is different. Then don't use non-ASCII characters and these letters if case-insensitive.
+	bool unicodeCase = options & (PCRE2_UTF | PCRE2_UCP);
+	auto usable = [unicodeCase](UINT c, bool ignoreCase) { return !(ignoreCase && unicodeCase) || (c < 128 && !wcschr(L"kKsS", (WCHAR)c)); };
+
+	Buffer<WCHAR, 300> run(len + 1), best(len + 1);
+	int runLen = 0, bestLen = 0; BYTE runAnchor = 0, bestAnchor = 0;
+	auto endRun = [&](BYTE anchor) {
+		if(runLen > bestLen) { memcpy(best, run, runLen * 2); bestLen = runLen; bestAnchor = anchor ? anchor : runAnchor; }
+		runLen = 0; runAnchor = 0;
+	};
+
+	if(!(options & (PCRE2_EXTENDED | PCRE2_EXTENDED_MORE | PCRE2_LITERAL)) && Find(rx, len, L"(*ACCEPT", 8, false) < 0) {
+		bool prevLiteral = false, atStart = len > 0 && rx[0] == '^' && !(options & PCRE2_MULTILINE);
+		for(size_t i = atStart ? 1 : 0; i < len; ) {
+			WCHAR c = rx[i++];
+			switch(c) {
+			case '\\':
+				if(i == len) goto gFail;
+				c = rx[i++];
+				if(iswalnum(c) || c >= 128) { //\d, \x{...}, \p{...} etc
+					if(c == 'Q' || c == 'E') goto gFail;
+					if(i < len && (rx[i] == '{' || (IsIn(c, 'g', 'k') && IsIn(rx[i], '<', '\'')))) { //\x{...}, \g{...}, \k<name> etc
+						WCHAR e = rx[i] == '{' ? '}' : rx[i] == '<' ? '>' : '\'';
+						while(i < len && rx[i] != e) i++;
+						i++;
+					} else if(c == 'x') { for(int k = 0; k < 2 && i < len && iswxdigit(rx[i]); k++) i++; } //\xhh
+					else if(IsIn(c, 'c', 'p', 'P')) i++; //\cX, \pL
+					else if(c == 'g' || iswdigit(c)) { //\g1, \g-1, \1, \012
+						if(c == 'g' && i < len && IsIn(rx[i], '-', '+')) i++;
+						while(i < len && iswdigit(rx[i])) i++;
+					}
+					break;
+				}
+				goto gLiteral;
+			case '[': //skip character class
+				if(i < len && rx[i] == '^') i++;
+				if(i < len && rx[i] == ']') i++;
+				for(; i < len && rx[i] != ']'; i++) {
+					if(rx[i] == '\\') i++;
+					else if(rx[i] == '[' && i + 1 < len && rx[i + 1] == ':') { for(i += 2; i < len && !(rx[i] == ']' && rx[i - 1] == ':'); ) i++; }
+				}
+				i++;
+				break;
+			case '(':
+				if(i < len && rx[i] == '*') goto gFail; //(*UTF), (*CR) etc
+				if(i + 1 < len && rx[i] == '?' && rx[i + 1] == '#') { //comment. A quantifier after it applies to the item before it.
+					while(i < len && rx[i] != ')') i++;
+					i++;
+					continue;
+				}
+				if(i + 1 < len && rx[i] == '?') { //(?i), (?i:...), (?R) etc
+					WCHAR k = rx[i + 1];
+					if((iswalpha(k) && k != 'P' && k != 'C') || k == '-' || k == '^' || k == '&' || k == '+') goto gFail;
+				}
+				for(int depth = 1; i < len && depth > 0; i++) { //skip group
+					switch(rx[i]) {
+					case '\\': i++; break;
+					case '(': depth++; break;
+					case ')': depth--; break;
+					case '[':
+						if(++i < len && rx[i] == '^') i++;
+						if(i < len && rx[i] == ']') i++;
+						while(i < len && rx[i] != ']') { if(rx[i] == '\\') i++; i++; }
+						break;
+					}
+				}
+				break;
+			case '|': goto gFail; //top-level alternatives
+			case '.': case '^': case ')': break;
+			case '$':
+				if(i == len && prevLiteral) { endRun(2); goto gr; }
+				break;
+			case '{': { //quantifier like {2} or {1,}, else literal (treat as non-literal)
+				size_t j = i; while(j < len && (iswdigit(rx[j]) || rx[j] == ',' || rx[j] == ' ')) j++;
+				if(j == len || rx[j] != '}') break;
+				i = j + 1;
+			} [[fallthrough]];
+			case '*': case '?':
+				if(prevLiteral) runLen--; //the previous literal is optional
+				if(i < len && (rx[i] == '?' || rx[i] == '+')) i++; //lazy, possessive
+				break;
+			case '+':
+				if(i < len && (rx[i] == '?' || rx[i] == '+')) i++;
+				break;
+			default:
+			gLiteral:
+				if(!usable(c, _ignoreCase)) break;
+				if(runLen == 0 && atStart) runAnchor = 1;
+				run[runLen++] = c;
+				prevLiteral = true;
+				atStart = false;
+				continue;
 			}
+			//not a literal
+			endRun(0);
+			prevLiteral = atStart = false;
 		}
-		if(nNot == _multi_count) return !_not; //there are no parts without option n
+	}
+	if(false) { gFail: bestLen = runLen = 0; } //unsupported syntax. Maybe there is a top-level '|' somewhere after it.
+gr:
+	endRun(0);
+
+	bool ignoreCase = _ignoreCase;
+	if(bestLen == 0) { //use the first or last code unit. Don't know whether caseless, therefore assume it is.
+		ignoreCase = true;
+		if(lastType == 1 && usable(lastUnit, true)) best[bestLen++] = (WCHAR)lastUnit;
+		else if(firstType == 1 && usable(firstUnit, true)) best[bestLen++] = (WCHAR)firstUnit;
+		bestAnchor = 0;
+	}
+	if(bestLen == 0 && minLen < 2) return;
+
+	auto f = (_RegexFilter*)malloc(sizeof(_RegexFilter) + bestLen * 2);
+	f->minLen = (int)minLen;
+	f->litLen = bestLen;
+	f->ignoreCase = ignoreCase;
+	f->anchor = bestAnchor;
+	memcpy(f->lit, best, bestLen * 2);
+	_rxFilter = f;
+}
 
-		//non-[n] parts: at least one must match
-		for(int i = 0; i < _multi_count; i++) {
-			Wildex& w = _multi_array[i];
-			if(!w._not && w.Match(s, lenS)) return !_not;
+//Returns false if the string cannot match _regex. Returns true if can match or if _rxFilter is null.
+bool Wildex::_RegexFilterMatch(STR s, size_t lenS) const
+{
+	auto f = _rxFilter;
+	if(f == null) return true;
+	if(lenS < (size_t)f->minLen) return false;
+	size_t n = f->litLen;
+	if(n == 0) return true;
+	if(lenS < n) return false;
+	switch(f->anchor) {
+	case 1: return Equals(f->lit, n, s, n, f->ignoreCase);
+	case 2: //'$' also matches before the final newline. Depending on PCRE2 newline settings it can be "\n", "\r\n" etc.
+		for(size_t end = lenS; ; end--) {
+			if(Equals(f->lit, n, s + end - n, n, f->ignoreCase)) return true;
+			WCHAR c = s[end - 1];
+			if(end == n || lenS - end == 2 || c == 0 || !wcschr(L"\n\r\x0b\x0c\x85\x2028\x2029", c)) return false;
 		}
-		break;
 	}
-	return R ^ _not;
+	return Find(s, lenS, f->lit, n, f->ignoreCase) >= 0;
+}
+
+//Executes _wild. The result is the same as of Like(s, lenS, _text, _text_length, _ignoreCase).
+bool Wildex::_MatchWildcard(STR s, size_t lenS) const
+{
+	const _WildProg& p = *_wild;
+	if(lenS < (size_t)p.minLen) return false;
+	if(lenS == 0) return _text_length == 1; //"*". Like returns false for eg "**".
+
+	STR w = _text;
+	const _WildSeg& head = p.seg[0];
+	if(p.nSeg == 1) return lenS == (size_t)head.len && _WildSegEquals(s, w, head, _ignoreCase);
+
+	const _WildSeg& tail = p.seg[p.nSeg - 1];
+	if(!_WildSegEquals(s, w, head, _ignoreCase)) return false;
+	if(!_WildSegEquals(s + lenS - tail.len, w, tail, _ignoreCase)) return false;
+
+	size_t i = head.len, to = lenS - tail.len;
+	for(int j = 1; j < p.nSeg - 1; j++) {
+		const _WildSeg& g = p.seg[j];
+		int k = _WildSegFind(s + i, to - i, w, g, _ignoreCase);
+		if(k < 0) return false;
+		i += k + g.len;
+	}
+	return true;
 }
 
 /// <summary>
@@ -509,6 +2045,11 @@ bool Wildex::Match(STR s, size_t lenS) const
 	return false; yes: return true;
 }
 
+//Gets statistics of the Wildex::ParseCached cache. See Wildex::CacheStats.
+EXPORT void Cpp_WildexCacheStats(out __int64& hits, out __int64& misses, out int& count) {
+	Wildex::CacheStats(hits, misses, count);
+}
+
 //EXPORT bool Cpp_WildexParse(Wildex& x, STR w, size_t lenW, out BSTR* errStr) {
 //	return x.Parse(w, lenW, false, errStr);
 //}
@@ -76,6 +76,59 @@ private:
 	//tested: the __declspec(noinline) functions are added once for all T, making template instance code very small.
 };
 
+//Bump allocator for objects that are freed all at once.
+//Allocates from fixed-size memory in this variable (eg on stack). When it is full, allocates heap blocks. Frees them in dtor.
+//Does not call ctors/dtors.
+template <size_t nStackBytes = 2000>
+class Arena {
+	static const size_t c_align = 16;
+
+	BYTE* _p;
+	size_t _left;
+	void* _heap; //list of heap blocks. The first pointer-size bytes of a block is the next block.
+	alignas(c_align) BYTE _stack[nStackBytes];
+public:
+	Arena() noexcept { _p = _stack; _left = nStackBytes; _heap = nullptr; }
+
+	~Arena() { _FreeHeap(_heap); }
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	//Allocates size bytes, aligned by 16.
+	void* Alloc(size_t size) {
+		size = (size + c_align - 1) & ~(c_align - 1);
+		if (size > _left) _AllocBlock(size);
+		void* R = _p; _p += size; _left -= size;
+		return R;
+	}
+
+	//Allocates memory for nElem elements of type T. Does not call ctors.
+	template <class T>
+	T* Alloc(size_t nElem) { return (T*)Alloc(nElem * sizeof(T)); }
+
+	//Allocates a '\0'-terminated copy of string s of length len.
+	LPWSTR CopyString(STR s, size_t len) {
+		auto R = Alloc<WCHAR>(len + 1);
+		memcpy(R, s, len * 2); R[len] = 0;
+		return R;
+	}
+
+private:
+	__declspec(noinline)
+		void _AllocBlock(size_t size) {
+		size_t n = max(size, max(nStackBytes, (size_t)4096)) + c_align;
+		auto b = (BYTE*)malloc(n);
+		*(void**)b = _heap; _heap = b;
+		_p = b + c_align; _left = n - c_align;
+	}
+
+	__declspec(noinline)
+		static void _FreeHeap(void* b) {
+		while (b) { void* next = *(void**)b; free(b); b = next; }
+	}
+};
+
 namespace str {
 	//null-safe wcslen.
 	inline size_t Len(STR s) { return s ? wcslen(s) : 0; }
@@ -230,6 +283,83 @@ namespace str {
 			if (code != null) pcre2_code_free_16(code);
 		}
 
+		//Cpp_RegexMatch results.
+		struct RegexMatch
+		{
+			//[out] Array that receives x=from and y=to of match and submatches.
+			//Func allocates thread-local memory for it. Then caller copies it ASAP and does not free.
+			//tested: this is the fastest way when caller is C#.
+			//Func sets it on full and partial match. Else sets null.
+			POINT* vec;
+
+			//[out] vec element count: groups + 1 if matched, 0 if not, 1 if partial.
+			int vecCount;
+
+			//[out] pcre2_get_startchar_16.
+			int indexNoK;
+
+			//[out] pcre2_get_mark_16.
+			STR mark;
+		};
+
+		//Cpp_RegexFindAllStart iterator. Opaque.
+		struct RegexFindAll;
+
+		//Cpp_RegexStreamStart matcher. Opaque.
+		struct RegexStream;
+
+		//Cpp_RegexStreamFeed result: start and end offset of a match or group, from the start of the stream. -1 if the group is unset.
+		struct RegexSpan { __int64 start, end; };
+
+		//Cpp_RegexCompileBulk item.
+		struct RegexCompileItem
+		{
+			//[in] Cpp_RegexCompile parameters.
+			STR rx; size_t len; __int64 flags;
+
+			//[out] Cpp_RegexCompile results. If errStr not null, caller must SysFreeString it.
+			pcre2_code_16* code; int codeSize; BSTR errStr;
+		};
+
+		//Cpp_RegexCacheSerialize item: a regular expression compiled by Cpp_RegexCompile, and the pattern and flags passed to it.
+		struct RegexCacheItem { STR rx; size_t len; __int64 flags; pcre2_code_16* code; };
+
+		//Regular expressions loaded by Cpp_RegexCacheLoad. Opaque.
+		struct RegexCache;
+
+		//Cpp_RegexMatchBatch subject.
+		struct RegexSubject { STR s; size_t len; };
+
+		//Cpp_RegexMatchBatch result for a subject.
+		struct RegexBatchResult
+		{
+			//pcre2_match_16 return value: >0 if matched, PCRE2_ERROR_NOMATCH if not, 0 if partial match, other <0 if failed (eg invalid UTF).
+			int result;
+
+			//Start and end of the match (group 0), also on partial match. Else -1.
+			int start, end;
+		};
+
+		//Cpp_RegexMatchBudget limits. 0 means the default limit.
+		//When a limit is exceeded, the match returns PCRE2_ERROR_MATCHLIMIT, PCRE2_ERROR_DEPTHLIMIT, PCRE2_ERROR_HEAPLIMIT or c_rxErrorTimeout.
+		struct RegexBudget
+		{
+			//pcre2_set_match_limit_16: max number of backtracking steps. Default 10 000 000.
+			UINT matchLimit;
+
+			//pcre2_set_depth_limit_16: max backtracking depth.
+			UINT depthLimit;
+
+			//pcre2_set_heap_limit_16: max heap memory for backtracking, in KiB. Default 20 000 000.
+			UINT heapLimit;
+
+			//Max match time, in milliseconds.
+			UINT timeoutMs;
+		};
+
+		//Cpp_RegexMatchBudget returns it when RegexBudget::timeoutMs is exceeded. Not a PCRE error code.
+		const int c_rxErrorTimeout = -100;
+
 	};
 
 
@@ -246,18 +376,46 @@ namespace str {
 			Text,
 
 			/// Wildcard (has *? characters and no t r options).
-			/// Match() calls str::Like.
+			/// Parse() compiles it into segments separated by '*' (see _WildProg). Match() executes it; the result is the same as of str::Like.
 			Wildcard,
 
 			/// PCRE regular expression (option r).
+			/// Parse() also creates _RegexFilter, and Match() calls pcre2_match only if the string passes it.
 			RegexPcre,
 
 			/// Multiple parts (option m).
 			/// Match() calls Match() for each part and returns true if all negative (option n) parts return true (or there are no such parts) and some positive (no option n) part returns true (or there are no such parts).
+			/// If there are many Text and Wildcard parts, Parse() creates _MultiIndex, and Match() uses it to match all these parts in one pass.
 			Multi,
 		};
 
 	private:
+		//Part of wildcard expression between '*' characters. Can contain '?'.
+		struct _WildSeg {
+			int start, len; //in _text
+			int anchor, anchorLen; //the longest part without '?'. Used to find the segment with str::Find. If anchorLen == len, there are no '?'.
+		};
+
+		//Compiled wildcard expression. Parse creates it for WildType::Wildcard.
+		//If there are '*', seg[0] is anchored at the start of string, seg[nSeg-1] at the end (both can be empty), and other segments are found in order between them.
+		//	Finding the leftmost match of each segment is correct because segments have fixed length.
+		//If there are only '?', nSeg is 1, and the string length must be == minLen.
+		struct _WildProg {
+			int nSeg;
+			int minLen; //sum of segment lengths
+			_WildSeg seg[1];
+		};
+
+		//Used for WildType::RegexPcre to quickly reject strings that cannot match, without calling pcre2_match.
+		//Parse creates it from the regular expression (a literal substring that must be in any match) and from PCRE2_INFO_MINLENGTH etc.
+		struct _RegexFilter {
+			int minLen; //PCRE2_INFO_MINLENGTH
+			int litLen; //length of lit. Can be 0.
+			bool ignoreCase;
+			BYTE anchor; //1 - lit must be at the start of string, 2 - at the end (or before the final '\n'), 0 - anywhere
+			WCHAR lit[1];
+		};
+
 		union {
 			LPWSTR _text;
 			pcre2_code_16* _regex;
@@ -267,29 +425,113 @@ namespace str {
 			int _text_length;
 			int _multi_count;
 		};
+		struct _MultiIndex;
+		struct _CacheEntry;
+
+		union {
+			_WildProg* _wild; //if WildType::Wildcard
+			_MultiIndex* _multiIndex; //if WildType::Multi. Can be null.
+			_RegexFilter* _rxFilter; //if WildType::RegexPcre. Can be null.
+		};
+		_CacheEntry* _cached; //if not null, this is a copy of _cached->x, created by ParseCached. The dtor releases _cached instead of freeing.
 		WildType _type;
 		bool _ignoreCase;
 		bool _not;
 		bool _freeText;
 
+		void _CompileWildcard();
+		void _CreateRegexFilter(STR rx, size_t len);
+		bool _RegexFilterMatch(STR s, size_t lenS) const;
+		bool _MatchWildcard(STR s, size_t lenS) const;
+		bool _MatchMulti(STR s, size_t lenS) const;
+		static bool _WildSegEquals(STR s, STR w, const _WildSeg& g, bool ignoreCase);
+		static int _WildSegFind(STR s, size_t lenS, STR w, const _WildSeg& g, bool ignoreCase);
+
 	public:
 		Wildex() { ZEROTHIS; }
 		~Wildex();
 		bool Parse(STR w, size_t lenW, bool dontCopyString = false, out BSTR* errStr = null);
+		bool ParseCached(STR w, size_t lenW, out BSTR* errStr = null);
 		bool Match(STR s, size_t lenS) const;
 		//Returns true if not null.
 		bool Is() const { return _text != null; }
 
 		static bool HasWildcards(STR s, size_t lenS);
+		static void CacheStats(out __int64& hits, out __int64& misses, out int& count);
 	};
 
 	EXPORT STR Cpp_LowercaseTable();
 	bool Like(STR s, size_t lenS, STR w, size_t lenW, bool ignoreCase = false);
 	bool Equals(STR w, size_t lenW, STR s, size_t lenS, bool ignoreCase = false);
+	int Find(STR s, size_t lenS, STR w, size_t lenW, bool ignoreCase = false);
 
 	int Switch(STR s, size_t lenS, std::initializer_list<STR> a);
 	int Switch(STR s, std::initializer_list<STR> a);
 
+	//Like str::Switch, but uses a perfect hash table created at compile time. Use for lists of keywords in hot code.
+	//Example:
+	//	static constexpr str::SwitchTable s_names({ L"one", L"two", L"three" });
+	//	int i = s_names.Switch(L"two", 3); //2
+	//Compile-time error if the list contains duplicate strings or more than 255 strings.
+	template<size_t N>
+	class SwitchTable {
+		static_assert(N > 0 && N < 256);
+		static constexpr size_t c_size = [] { size_t n = 4; while (n < N * 2) n <<= 1; return n; }(); //table size, power of 2
+		static constexpr size_t c_maxLen = 255;
+
+		STR _a[N];
+		BYTE _len[N];
+		BYTE _slot[c_size * 2]; //1-based index in _a, or 0. If c_size is too small, uses the second half too.
+		UINT _seed, _mask;
+
+		static constexpr UINT _Hash(STR s, size_t len, UINT seed) {
+			UINT h = 2166136261 ^ seed; //FNV-1a
+			for (size_t i = 0; i < len; i++) h = (h ^ s[i]) * 16777619;
+			return h ^ (h >> 16);
+		}
+
+		//Tries to fill _slot with hash seed. Returns false if there are collisions.
+		constexpr bool _TryFill(UINT seed) {
+			for (auto& v : _slot) v = 0;
+			for (size_t i = 0; i < N; i++) {
+				BYTE& v = _slot[_Hash(_a[i], _len[i], seed) & _mask];
+				if (v != 0) return false;
+				v = (BYTE)(i + 1);
+			}
+			return true;
+		}
+
+	public:
+		consteval SwitchTable(const STR(&a)[N]) : _a(), _len(), _slot(), _seed(0), _mask(0) {
+			for (size_t i = 0; i < N; i++) {
+				size_t len = 0; while (a[i][len]) len++;
+				if (len > c_maxLen) throw "too long string";
+				_a[i] = a[i]; _len[i] = (BYTE)len;
+				for (size_t j = 0; j < i; j++) {
+					if (_len[j] == len && std::char_traits<WCHAR>::compare(_a[j], a[i], len) == 0) throw "duplicate string";
+				}
+			}
+			//find a seed without collisions. Usually finds in the first table size; then the second half of _slot is unused.
+			for (_mask = c_size - 1; _mask < c_size * 2; _mask = _mask * 2 + 1) {
+				for (_seed = 0; _seed < 10000; _seed++) if (_TryFill(_seed)) return;
+			}
+			throw "failed to create perfect hash";
+		}
+
+		//Compares string s of length lenS with the strings, and returns 1-based index of the matched string, or 0 if none matches.
+		//If s==null, returns 0.
+		int Switch(STR s, size_t lenS) const {
+			if (s == null || lenS > c_maxLen) return 0;
+			int i = _slot[_Hash(s, lenS, _seed) & _mask];
+			if (i == 0 || _len[i - 1] != lenS || memcmp(_a[i - 1], s, lenS * 2)) return 0;
+			return i;
+		}
+
+		//Compares '\0'-terminated string s with the strings, and returns 1-based index of the matched string, or 0 if none matches.
+		//If s==null, returns 0.
+		int Switch(STR s) const { return s == null ? 0 : Switch(s, wcslen(s)); }
+	};
+
 
 } //namespace str
 
@@ -1,5 +1,7 @@
 #include "stdafx.h"
 #include "cpp.h"
+#include "SlabPool.h"
+#include "acc.h"
 //#include "ISimpleDOMNode.h"
 
 //#include <sphelper.h>
@@ -221,6 +223,841 @@ EXPORT void Cpp_TestWildex(STR s, STR w) {
 	Print(yes);
 }
 
+//Typical accessible object names. Used by Wildex benchmarks.
+static const STR s_testAccNames[] = {
+	L"File", L"Edit", L"View", L"Help", L"Save", L"Save As...", L"Save all", L"Open", L"Close", L"OK", L"Cancel", L"Apply",
+	L"Minimize", L"Maximize", L"Restore", L"System", L"Application", L"Navigation pane", L"Address and search bar",
+	L"Reload", L"Back", L"Forward", L"New Tab", L"Bookmarks bar", L"Downloads", L"Extensions", L"Settings", L"Search",
+	L"Search in this page", L"Zoom in", L"Zoom out", L"Vertical", L"Horizontal", L"Line up", L"Line down", L"Page up", L"Page down",
+	L"Position", L"Column 1", L"Row 152", L"Item 42 of 100", L"https://www.example.com/products/automation/index.html",
+	L"Click here to save your changes before closing the dialog", L"Don't save", L"R\xE9sum\xE9", L"Stra\xDF" L"e", L"\x421\x43E\x445\x440\x430\x43D\x438\x442\x44C \x43A\x430\x43A",
+	L"\x4FDD\x5B58", L"", L"Toolbar", L"Status bar", L"Ready", L"Ln 1, Col 1", L"100%", L"Windows (CRLF)", L"UTF-8",
+};
+
+//Compares Wildex "*substring*" (str::Find, SIMD) with str::Like. Prints mismatches and times.
+EXPORT void Cpp_TestWildexSubstring() {
+	STR patterns[] = { L"*Save*", L"*save*", L"*bar*", L"*of 100*", L"*example.com/products*", L"*x*", L"*STRASSE*", L"*\x441\x43E\x445\x440\x430\x43D\x438\x442\x44C*" };
+	const int nNames = _countof(s_testAccNames), nRepeat = 1000; //~55000 names, like a big web page
+
+	for (int j = 0; j < _countof(patterns); j++) {
+		for (int cs = 0; cs < 2; cs++) {
+			STR w = patterns[j]; auto lenW = wcslen(w);
+			Bstr b(cs ? L"**c " : L""); b.Append(w);
+			str::Wildex x;
+			if (!x.Parse(b, b.Length())) return;
+
+			int nLike = 0, nFind = 0;
+			Perf.First();
+			for (int r = 0; r < nRepeat; r++) for (int i = 0; i < nNames; i++) {
+				STR s = s_testAccNames[i];
+				if (str::Like(s, wcslen(s), w, lenW, !cs)) nLike++;
+			}
+			Perf.Next('L');
+			for (int r = 0; r < nRepeat; r++) for (int i = 0; i < nNames; i++) {
+				STR s = s_testAccNames[i];
+				if (x.Match(s, wcslen(s))) nFind++;
+			}
+			Perf.Next('F');
+
+			Printf(L"%s%s: Like=%i, Find=%i%s", cs ? L"**c " : L"", w, nLike / nRepeat, nFind / nRepeat, nLike == nFind ? L"" : L"    <<<<<<<<<< MISMATCH");
+			Perf.Write();
+		}
+	}
+}
+
+//Compares results of Wildex (compiled wildcard program) and str::Like with random wildcard expressions and strings. Prints mismatches.
+//Then compares speed with typical wildcard expressions.
+EXPORT void Cpp_TestWildexProgram() {
+	auto rnd = [](LPWSTR b, int maxLen, STR chars) {
+		int n = rand() % (maxLen + 1), nc = (int)wcslen(chars);
+		for (int i = 0; i < n; i++) b[i] = chars[rand() % nc];
+		b[n] = 0;
+		return n;
+	};
+
+	srand(1);
+	int nTests = 0, nBad = 0;
+	for (int i = 0; i < 1000000; i++) {
+		WCHAR s[100], w[20];
+		int lenS = rnd(s, i % 3 ? 12 : 60, L"aAbBkK\x212A\xE9\xC9x"), lenW = rnd(w + 4, 8, L"aAbBk\x212A\xE9**??");
+		if (lenW == 0 || (lenW >= 3 && w[4] == '*' && w[5] == '*')) continue;
+		for (int cs = 0; cs < 2; cs++) {
+			bool yes1 = str::Like(s, lenS, w + 4, lenW, !cs);
+			str::Wildex x;
+			if (cs) { memcpy(w, L"**c ", 8); x.Parse(w, lenW + 4, true); } else x.Parse(w + 4, lenW, true);
+			bool yes2 = x.Match(s, lenS);
+			nTests++;
+			if (yes1 != yes2 && nBad++ < 10) Printf(L"MISMATCH: Like=%i, w=\"%s\", s=\"%s\"", yes1, cs ? w : w + 4, s);
+		}
+	}
+	Printf(L"tests=%i, mismatches=%i", nTests, nBad);
+
+	STR patterns[] = { L"Save*", L"*bar", L"*Save*", L"S?ve*", L"*search*bar", L"https://*/products/*.html", L"*m*n*" };
+	const int nNames = _countof(s_testAccNames), nRepeat = 1000;
+	for (int j = 0; j < _countof(patterns); j++) {
+		STR w = patterns[j]; auto lenW = wcslen(w);
+		str::Wildex x; x.Parse(w, lenW);
+		int n1 = 0, n2 = 0;
+		Perf.First();
+		for (int r = 0; r < nRepeat; r++) for (int i = 0; i < nNames; i++) {
+			STR s = s_testAccNames[i];
+			if (str::Like(s, wcslen(s), w, lenW, true)) n1++;
+		}
+		Perf.Next('L');
+		for (int r = 0; r < nRepeat; r++) for (int i = 0; i < nNames; i++) {
+			STR s = s_testAccNames[i];
+			if (x.Match(s, wcslen(s))) n2++;
+		}
+		Perf.Next('W');
+		Printf(L"%s: Like=%i, Wildex=%i", w, n1 / nRepeat, n2 / nRepeat);
+		Perf.Write();
+	}
+}
+
+//Compares results and speed of Wildex with option m (_MultiIndex) and separate Wildex for each part.
+EXPORT void Cpp_TestWildexMulti() {
+	str::StringBuilder b; b << L"**m ";
+	const int nParts = 40;
+	for (int i = 0; i < nParts; i++) {
+		if (i > 0) b << L"||";
+		switch (i % 4) {
+		case 0: b << L"*" << s_testAccNames[i] << L"*"; break;
+		case 1: b << s_testAccNames[i] << L"*"; break;
+		case 2: b << L"**c " << s_testAccNames[i]; break;
+		default: b << s_testAccNames[i]; break;
+		}
+	}
+	b << L"||**n *Save as*";
+
+	str::Wildex x;
+	Bstr es; if (!x.Parse(b, b.Length(), false, &es)) { Print(es); return; }
+
+	str::Wildex a[nParts + 1];
+	STR t = b + 4;
+	for (int i = 0; i <= nParts; i++) {
+		STR e = wcsstr(t, L"||"); if (!e) e = t + wcslen(t);
+		a[i].Parse(t, e - t);
+		t = e + 2;
+	}
+
+	const int nNames = _countof(s_testAccNames), nRepeat = 1000;
+	int n1 = 0, n2 = 0, nBad = 0;
+	Perf.First();
+	for (int r = 0; r < nRepeat; r++) for (int i = 0; i < nNames; i++) {
+		STR s = s_testAccNames[i];
+		if (x.Match(s, wcslen(s))) n1++;
+	}
+	Perf.Next('M');
+	for (int r = 0; r < nRepeat; r++) for (int i = 0; i < nNames; i++) {
+		STR s = s_testAccNames[i]; auto len = wcslen(s);
+		bool yes = a[nParts].Match(s, len);
+		if (yes) { yes = false; for (int j = 0; j < nParts; j++) if (a[j].Match(s, len)) { yes = true; break; } }
+		if (yes) n2++;
+		if (r == 0 && yes != x.Match(s, len) && nBad++ < 10) Printf(L"MISMATCH: \"%s\"", s);
+	}
+	Perf.Next('S');
+	Printf(L"multi=%i, separate=%i", n1 / nRepeat, n2 / nRepeat);
+	Perf.Write();
+}
+
+//Compares Cpp_LowercaseTable with CharLowerBuff of all characters, and Equals(ignoreCase) with the ASCII fast path.
+//Also calls Cpp_LowercaseTable in several threads at the same time. Call this before other Wildex/Equals tests, else the table is already created.
+EXPORT void Cpp_TestLowercaseTable() {
+	const int nThreads = 8;
+	STR tables[nThreads] = {}; HANDLE threads[nThreads];
+	Perf.First();
+	for (int i = 0; i < nThreads; i++) threads[i] = CreateThread(null, 0, [](LPVOID p) -> DWORD { *(STR*)p = str::Cpp_LowercaseTable(); return 0; }, tables + i, 0, null);
+	WaitForMultipleObjects(nThreads, threads, true, INFINITE);
+	Perf.Next('t');
+	for (int i = 0; i < nThreads; i++) { CloseHandle(threads[i]); if (tables[i] != tables[0]) Print(L"different table"); }
+
+	static WCHAR r[0x10000];
+	for (int i = 0; i < 0x10000; i++) r[i] = (WCHAR)i;
+	CharLowerBuff(r, 0x10000);
+	Perf.Next('C');
+	Perf.Write();
+
+	STR t = tables[0];
+	int nBad = 0;
+	for (int i = 0; i < 0x10000; i++) if (t[i] != r[i] && nBad++ < 10) Printf(L"MISMATCH: 0x%X  0x%X  0x%X", i, t[i], r[i]);
+
+	//ASCII fast path. Non-ASCII characters can be lowercased to ASCII, eg KELVIN SIGN.
+	for (int i = 0; i < 0x10000; i++) {
+		if (i >= 0xD800 && i < 0xE000) continue;
+		WCHAR a = (WCHAR)i;
+		for (WCHAR b : { L'a', L'k', L's', L'i', L'K', L'S', (WCHAR)(i ^ 0x20), r[i] }) {
+			if (str::Equals(&a, 1, &b, 1, true) != (a == b || r[a] == r[b]) && nBad++ < 20) Printf(L"Equals MISMATCH: 0x%X  0x%X", a, b);
+		}
+	}
+	Printf(L"nBad=%i", nBad);
+}
+
+//Compares results and speed of case-insensitive Equals (SIMD) and a scalar loop with the lowercase table, for short, medium and long strings.
+EXPORT void Cpp_TestEqualsI() {
+	STR table = str::Cpp_LowercaseTable();
+	auto scalar = [table](STR a, STR b, int n) { for (int i = 0; i < n; i++) if (a[i] != b[i] && table[a[i]] != table[b[i]]) return false; return true; };
+
+	//results. Strings with ASCII letters of different case, non-ASCII letters, and KELVIN SIGN etc that are lowercased to ASCII.
+	static const WCHAR pool[] = L"aAkKsSzZ@[`{\x212A\x17F\x130\xC0\xE0\x410\x430\x7F\x80\xFF21\xFF41 09";
+	WCHAR a[70], b[70];
+	int nBad = 0;
+	srand(1);
+	for (int i = 0; i < 1000000; i++) {
+		int n = rand() % 70;
+		for (int j = 0; j < n; j++) a[j] = b[j] = pool[rand() % (_countof(pool) - 1)];
+		for (int k = rand() % 4; k > 0 && n > 0; k--) { int j = rand() % n; b[j] = rand() % 2 ? b[j] ^ 0x20 : table[b[j]]; }
+		if (str::Equals(a, n, b, n, true) != scalar(a, b, n) && nBad++ < 10) Printf(L"MISMATCH: \"%.*s\"  \"%.*s\"", n, a, n, b);
+	}
+	Printf(L"nBad=%i", nBad);
+
+	//speed
+	for (int n : { 6, 16, 64, 1000 }) {
+		str::StringBuilder s1, s2;
+		for (int i = 0; i < n; i++) { s1 << (WCHAR)('a' + i % 26); s2 << (WCHAR)('A' + i % 26); }
+		STR p1 = s1, p2 = s2;
+		int nRepeat = 10000000 / n, c1 = 0, c2 = 0;
+		Perf.First();
+		for (int r = 0; r < nRepeat; r++) c1 += scalar(p1, p2, n);
+		Perf.Next('t');
+		for (int r = 0; r < nRepeat; r++) c2 += str::Equals(p1, n, p2, n, true);
+		Perf.Next('E');
+		Printf(L"length=%i, nRepeat=%i, %i %i", n, nRepeat, c1, c2);
+		Perf.Write();
+	}
+}
+
+bool AccFinderTestSetParams(const Cpp_AccFindParams& ap, out BSTR& errStr);
+static int s_nHeapCalls;
+
+//Counts CRT heap calls (malloc, realloc, free, new, delete) while AccFinder parses typical parameters.
+//Expected 0, because AccFinder uses Arena and Wildex::ParseCached. The first call fills the Wildex cache.
+EXPORT void Cpp_TestAccFinderAllocations() {
+	static const WCHAR prop[] = L"value=*Save*\0class=Button\0maxcc=100\0notin=TREE,LIST\0@id=**r ^btn\\d+$";
+	Cpp_AccFindParams ap;
+	ap.role = L"PUSHBUTTON"; ap.roleLength = 10;
+	ap.name = L"**m Save||Save as||**r ^Open"; ap.nameLength = (int)wcslen(ap.name);
+	ap.prop = prop; ap.propLength = _countof(prop) - 1;
+	Bstr es;
+	if (!AccFinderTestSetParams(ap, es.m_str)) { Print(es); return; }
+
+	s_nHeapCalls = 0;
+	auto hook = [](int allocType, void* userData, size_t size, int blockType, long requestNumber, const unsigned char* filename, int lineNumber) -> int {
+		if (blockType != _CRT_BLOCK) s_nHeapCalls++;
+		return TRUE;
+	};
+	auto oldHook = _CrtSetAllocHook(hook);
+	Perf.First();
+	for (int i = 0; i < 1000; i++) AccFinderTestSetParams(ap, es.m_str);
+	Perf.Next();
+	_CrtSetAllocHook(oldHook);
+	Printf(L"heap calls: %i", s_nHeapCalls);
+	Perf.Write();
+}
+
+//Compares speed of Wildex::Parse and Wildex::ParseCached, like when AccFinder is called in a wait loop. Prints cache statistics.
+EXPORT void Cpp_TestWildexCache() {
+	static const STR a[] = { L"**r ^Save( as)?$", L"**rc \\d+ items", L"**m Save||Open*||**r ^Close", L"*search*", L"Button" };
+	const int n = _countof(a), nRepeat = 1000;
+	__int64 hits1, misses1, hits2, misses2; int count;
+	str::Wildex::CacheStats(hits1, misses1, count);
+	Perf.First();
+	for (int r = 0; r < nRepeat; r++) for (int i = 0; i < n; i++) {
+		str::Wildex x; x.Parse(a[i], wcslen(a[i]), true);
+	}
+	Perf.Next('P');
+	for (int r = 0; r < nRepeat; r++) for (int i = 0; i < n; i++) {
+		str::Wildex x; x.ParseCached(a[i], wcslen(a[i]));
+		if (r == 0 && (i == 0 || i == 2) && !x.Match(L"Save", 4)) Printf(L"no match: %s", a[i]);
+	}
+	Perf.Next('C');
+	str::Wildex::CacheStats(hits2, misses2, count);
+	Printf(L"hits=%lld misses=%lld count=%i", hits2 - hits1, misses2 - misses1, count);
+	Perf.Write();
+}
+
+//Compares results and speed of str::Switch and str::SwitchTable, with the prop names of AccFinder::_ParseProp.
+EXPORT void Cpp_TestSwitch() {
+	static constexpr str::SwitchTable t({ L"value", L"desc", L"help", L"action", L"key", L"uiaid", L"uiacn", L"state", L"level", L"maxcc", L"notin", L"rect", L"item", L"class", L"id", L"url" });
+	static const STR a[] = { L"value", L"desc", L"help", L"action", L"key", L"uiaid", L"uiacn", L"state", L"level", L"maxcc", L"notin", L"rect", L"item", L"class", L"id", L"url", L"", L"x", L"Value", L"values", L"ur", L"@href" };
+	const int n = _countof(a), nRepeat = 100000;
+	int nBad = 0, c1 = 0, c2 = 0;
+	for (int i = 0; i < n; i++) {
+		size_t len = wcslen(a[i]);
+		int k = str::Switch(a[i], len, { L"value", L"desc", L"help", L"action", L"key", L"uiaid", L"uiacn", L"state", L"level", L"maxcc", L"notin", L"rect", L"item", L"class", L"id", L"url" });
+		if (t.Switch(a[i], len) != k || t.Switch(a[i]) != k) { nBad++; Printf(L"MISMATCH: \"%s\"", a[i]); }
+	}
+	Printf(L"nBad=%i", nBad);
+
+	Perf.First();
+	for (int r = 0; r < nRepeat; r++) for (int i = 0; i < n; i++) {
+		c1 += str::Switch(a[i], wcslen(a[i]), { L"value", L"desc", L"help", L"action", L"key", L"uiaid", L"uiacn", L"state", L"level", L"maxcc", L"notin", L"rect", L"item", L"class", L"id", L"url" });
+	}
+	Perf.Next('L');
+	for (int r = 0; r < nRepeat; r++) for (int i = 0; i < n; i++) c2 += t.Switch(a[i], wcslen(a[i]));
+	Perf.Next('H');
+	Printf(L"%i %i", c1, c2);
+	Perf.Write();
+}
+
+//Compares Wildex option r (with the literal prefilter) with direct pcre::Match. Prints mismatches and times.
+EXPORT void Cpp_TestWildexRegexFilter() {
+	static const STR a[] = { L"^Save.*dialog$", L"^Save", L"page$", L"Item \\d+ of", L"^[A-Z]\\w+$", L"Zoom (in|out)", L"Save|Open", L"(?i)close", L"\\bbar\\b", L"\xE9" };
+	const int nNames = _countof(s_testAccNames), nRepeat = 1000;
+	int nBad = 0;
+	for (int j = 0; j < _countof(a); j++) {
+		str::StringBuilder b; b << L"**r " << a[j];
+		str::Wildex x; Bstr es; if (!x.Parse(b, b.Length(), false, &es)) { Print(es); continue; }
+		auto code = str::pcre::Compile(a[j], wcslen(a[j]), PCRE2_CASELESS);
+		int c1 = 0, c2 = 0;
+		Perf.First();
+		for (int r = 0; r < nRepeat; r++) for (int i = 0; i < nNames; i++) {
+			STR s = s_testAccNames[i];
+			c1 += x.Match(s, wcslen(s));
+		}
+		Perf.Next('F');
+		for (int r = 0; r < nRepeat; r++) for (int i = 0; i < nNames; i++) {
+			STR s = s_testAccNames[i];
+			c2 += str::pcre::Match(code, s, wcslen(s));
+		}
+		Perf.Next('P');
+		if (c1 != c2) { nBad++; Printf(L"MISMATCH: %s  %i %i", a[j], c1, c2); }
+		Perf.Write();
+		str::pcre::Free(code);
+	}
+	Printf(L"nBad=%i", nBad);
+}
+
+EXPORT int Cpp_RegexMatch(pcre2_code_16* code, STR s, size_t len, size_t start, UINT flags,
+	int(*callout)(pcre2_callout_block*, void*), str::pcre::RegexMatch* m, bool needM, BSTR* errStr);
+
+//Measures ns/match of Cpp_RegexMatch (like C# calls it) and str::pcre::Match with short subjects.
+//Also of pcre2_match_16 with match data created/freed in each call, like it was before the thread-local match data.
+EXPORT void Cpp_TestRegexMatch() {
+	static const STR a[] = { L"^Save.*dialog$", L"(\\w+) (\\d+)", L"Item \\d+ of (\\d+)", L"^[A-Z]\\w+$" };
+	const int nNames = _countof(s_testAccNames), nRepeat = 2000;
+	LARGE_INTEGER f, t0, t1; QueryPerformanceFrequency(&f);
+	auto ns = [&]() { QueryPerformanceCounter(&t1); double r = (t1.QuadPart - t0.QuadPart) * 1e9 / f.QuadPart / (nNames * nRepeat); t0 = t1; return r; };
+	for (int j = 0; j < _countof(a); j++) {
+		auto code = str::pcre::Compile(a[j], wcslen(a[j]), PCRE2_CASELESS);
+		int c1 = 0, c2 = 0, c3 = 0, c4 = 0;
+		QueryPerformanceCounter(&t0);
+		for (int r = 0; r < nRepeat; r++) for (int i = 0; i < nNames; i++) {
+			STR s = s_testAccNames[i]; str::pcre::RegexMatch m;
+			c1 += Cpp_RegexMatch(code, s, wcslen(s), 0, 0, null, &m, true, null) > 0;
+		}
+		double t1 = ns();
+		for (int r = 0; r < nRepeat; r++) for (int i = 0; i < nNames; i++) {
+			STR s = s_testAccNames[i];
+			c2 += Cpp_RegexMatch(code, s, wcslen(s), 0, 0, null, null, false, null) > 0;
+		}
+		double t2 = ns();
+		for (int r = 0; r < nRepeat; r++) for (int i = 0; i < nNames; i++) {
+			STR s = s_testAccNames[i];
+			c3 += str::pcre::Match(code, s, wcslen(s));
+		}
+		double t3 = ns();
+		for (int r = 0; r < nRepeat; r++) for (int i = 0; i < nNames; i++) {
+			STR s = s_testAccNames[i];
+			auto md = pcre2_match_data_create_from_pattern_16(code, null);
+			c4 += pcre2_match_16(code, s, wcslen(s), 0, 0, md, null, null) > 0;
+			pcre2_match_data_free_16(md);
+		}
+		double t4 = ns();
+		Printf(L"%-20s  Cpp_RegexMatch %.0f ns, without m %.0f ns,  Match %.0f ns,  create/free md %.0f ns  (%i %i %i %i)", a[j], t1, t2, t3, t4, c1, c2, c3, c4);
+		str::pcre::Free(code);
+	}
+}
+
+EXPORT int Cpp_RegexMatchBatch(pcre2_code_16* code, const str::pcre::RegexSubject* a, int n, UINT flags, str::pcre::RegexBatchResult* r,
+	POINT* ovec, int ovecCount, int nThreads, BSTR* errStr);
+
+//Compares results and speed of Cpp_RegexMatchBatch (1 and 8 threads) and Cpp_RegexMatch for each subject.
+EXPORT void Cpp_TestRegexMatchBatch() {
+	static const STR a[] = { L"^Save.*dialog$", L"(\\w+) (\\d+)", L"(\\w+)(x)?(?<y>y)?" };
+	const int nNames = _countof(s_testAccNames), n = nNames * 2000, ovecCount = 3;
+	Buffer<str::pcre::RegexSubject> subjects(n);
+	for (int i = 0; i < n; i++) { STR s = s_testAccNames[i % nNames]; subjects[i] = { s, wcslen(s) }; }
+	Buffer<str::pcre::RegexBatchResult> r(n); Buffer<POINT> ovec(n * ovecCount);
+	int nBad = 0;
+	for (int j = 0; j < _countof(a); j++) {
+		auto code = str::pcre::Compile(a[j], wcslen(a[j]), PCRE2_CASELESS);
+		for (int nThreads = 1; nThreads <= 8; nThreads += 7) {
+			Perf.First();
+			int nMatched = Cpp_RegexMatchBatch(code, subjects, n, 0, r, ovec, ovecCount, nThreads, null);
+			Perf.Next('B');
+			int nMatched2 = 0;
+			for (int i = 0; i < n; i++) {
+				str::pcre::RegexMatch m;
+				int R = Cpp_RegexMatch(code, subjects[i].s, subjects[i].len, 0, 0, null, &m, true, null);
+				if (R > 0) nMatched2++;
+				bool ok = R == r[i].result && (R < 0 || (m.vec[0].x == r[i].start && m.vec[0].y == r[i].end));
+				for (int g = 0; ok && g < ovecCount; g++) {
+					POINT p = ovec[i * ovecCount + g];
+					ok = R > 0 && g < m.vecCount ? (p.x == m.vec[g].x && p.y == m.vec[g].y) : (p.x == -1 && p.y == -1);
+				}
+				if (!ok) nBad++;
+			}
+			Perf.Next('S');
+			Printf(L"%-20s  threads=%i  matched=%i %i", a[j], nThreads, nMatched, nMatched2);
+			Perf.Write();
+		}
+		str::pcre::Free(code);
+	}
+	Printf(L"nBad=%i", nBad);
+}
+
+EXPORT str::pcre::RegexFindAll* Cpp_RegexFindAllStart(pcre2_code_16* code, STR s, size_t len, size_t start, UINT flags, int(*callout)(pcre2_callout_block*, void*));
+EXPORT int Cpp_RegexFindAllNext(str::pcre::RegexFindAll* f, int maxMatches, POINT*& vec, int& vecCount, BSTR* errStr);
+EXPORT void Cpp_RegexFindAllEnd(str::pcre::RegexFindAll* f);
+
+//Finds all matches in a log-like text with Cpp_RegexFindAllNext (chunks of 1000 and all), and with a Cpp_RegexMatch loop like C# did. Compares results and speed.
+//Also prints the number of matches of some patterns that match empty strings.
+EXPORT void Cpp_TestRegexFindAll() {
+	str::StringBuilder b;
+	for (int i = 0; i < 20000; i++) b << L"2024-01-01 12:00:0" << (i % 10) << L" INFO item " << (i % 7) << L"\r\n";
+	STR s = b; size_t len = b.Length();
+	auto code = str::pcre::Compile(L"item (\\d)", 9);
+	int n1 = 0, n2 = 0, n3 = 0, nBad = 0;
+	POINT* v; int vc, n;
+	Perf.First();
+	auto f = Cpp_RegexFindAllStart(code, s, len, 0, 0, null);
+	while ((n = Cpp_RegexFindAllNext(f, 1000, v, vc, null)) > 0) n1 += n;
+	Cpp_RegexFindAllEnd(f);
+	Perf.Next('c');
+	f = Cpp_RegexFindAllStart(code, s, len, 0, 0, null);
+	n2 = Cpp_RegexFindAllNext(f, 0, v, vc, null);
+	Perf.Next('a');
+	str::pcre::RegexMatch m;
+	for (size_t start = 0; Cpp_RegexMatch(code, s, len, start, 0, null, &m, true, null) > 0; start = m.vec[0].y) {
+		if (n3 >= n2 || v[n3 * vc].x != m.vec[0].x || v[n3 * vc + 1].x != m.vec[1].x) nBad++;
+		n3++;
+	}
+	Perf.Next('m');
+	Cpp_RegexFindAllEnd(f);
+	str::pcre::Free(code);
+	Printf(L"n=%i %i %i, nBad=%i", n1, n2, n3, nBad);
+	Perf.Write();
+
+	static const STR a[] = { L"", L"a*", L"(*CRLF)x*", L"(?m)^", L"\\b" }; //expected 7, 6, 7, 2, 4 (PCRE is built with NEWLINE_DEFAULT ANYCRLF)
+	for (int j = 0; j < _countof(a); j++) {
+		code = str::pcre::Compile(a[j], wcslen(a[j]));
+		f = Cpp_RegexFindAllStart(code, L"ba\r\naa\r\n", 8, 0, 0, null);
+		Printf(L"%-10s  %i", a[j], Cpp_RegexFindAllNext(f, 0, v, vc, null));
+		Cpp_RegexFindAllEnd(f);
+		str::pcre::Free(code);
+	}
+}
+
+EXPORT int Cpp_RegexCompileBulk(str::pcre::RegexCompileItem* a, int n, int nThreads);
+
+//Compiles 2000 generated patterns with Cpp_RegexCompileBulk in 1 and 8 threads, and with str::pcre::Compile. Prints times.
+EXPORT void Cpp_TestRegexCompileBulk() {
+	const int n = 2000;
+	Buffer<str::pcre::RegexCompileItem> a(n);
+	Buffer<WCHAR> p(n * 40);
+	for (int i = 0; i < n; i++) {
+		WCHAR* t = p + i * 40;
+		int len = swprintf_s(t, 40, L"\\b(?:word%c|item\\d{%i})\\s+(\\w+)", 'a' + i % 26, 1 + i % 9);
+		a[i] = { t, (size_t)len, i % 2 ? PCRE2_CASELESS : 0x4LL << 32 }; //PCRE2_EXTRA_MATCH_WORD
+	}
+	for (int nThreads = 1; nThreads <= 8; nThreads += 7) {
+		Perf.First();
+		int nOK = Cpp_RegexCompileBulk(a, n, nThreads);
+		Perf.Next('b');
+		for (int i = 0; i < n; i++) str::pcre::Free(a[i].code);
+		Printf(L"threads=%i nOK=%i", nThreads, nOK);
+		Perf.Write();
+	}
+	Perf.First();
+	for (int i = 0; i < n; i++) str::pcre::Free(str::pcre::Compile(a[i].rx, a[i].len, a[i].flags));
+	Perf.NW('c');
+}
+
+EXPORT BSTR Cpp_RegexCacheSerialize(const str::pcre::RegexCacheItem* a, int n, BSTR* errStr);
+EXPORT str::pcre::RegexCache* Cpp_RegexCacheOpen(STR file);
+EXPORT pcre2_code_16* Cpp_RegexCacheGet(str::pcre::RegexCache* c, STR rx, size_t len, __int64 flags, int& codeSize);
+EXPORT void Cpp_RegexCacheFree(str::pcre::RegexCache* c);
+
+//Compiles regular expressions, saves them in a cache file, loads and compares. Prints compile and load times.
+EXPORT void Cpp_TestRegexCache() {
+	static const STR a[] = { L"^Save.*dialog$", L"(\\w+) (\\d+)", L"Item \\d+ of (\\d+)", L"^[A-Z]\\w+$", L"\\b(?:Zoom|Page|Line) (?:in|out|up|down)\\b", L"https?://[^/]+/(.+)", L"R\xE9sum\xE9", L"(?<year>\\d{4})-(?<month>\\d\\d)" };
+	const int n = _countof(a);
+	str::pcre::RegexCacheItem items[n]; pcre2_code_16* codes[n];
+	Perf.First();
+	for (int i = 0; i < n; i++) items[i] = { a[i], wcslen(a[i]), PCRE2_CASELESS, str::pcre::Compile(a[i], wcslen(a[i]), PCRE2_CASELESS) };
+	Perf.Next('c');
+	Bstr b; b.Attach(Cpp_RegexCacheSerialize(items, n, null));
+	Perf.Next('s');
+	WCHAR file[MAX_PATH]; GetTempPathW(MAX_PATH, file); wcscat_s(file, L"Cpp_TestRegexCache.bin");
+	FILE* f = _wfopen(file, L"wb"); fwrite(b, 1, SysStringByteLen(b), f); fclose(f);
+	Perf.Next('w');
+	auto c = Cpp_RegexCacheOpen(file);
+	for (int i = 0; i < n; i++) { int codeSize; codes[i] = Cpp_RegexCacheGet(c, a[i], wcslen(a[i]), PCRE2_CASELESS, codeSize); }
+	Perf.Next('l');
+	Cpp_RegexCacheFree(c);
+	DeleteFileW(file);
+
+	int nBad = 0;
+	for (int i = 0; i < n; i++) {
+		if (codes[i] == null) { nBad++; continue; }
+		for (int j = 0; j < _countof(s_testAccNames); j++) {
+			STR s = s_testAccNames[j]; size_t len = wcslen(s);
+			if (str::pcre::Match(codes[i], s, len) != str::pcre::Match(items[i].code, s, len)) nBad++;
+		}
+		str::pcre::Free(codes[i]); str::pcre::Free(items[i].code);
+	}
+	Printf(L"size=%i nBad=%i", SysStringByteLen(b), nBad);
+	Perf.Write();
+}
+
+struct _TestTraceOp { UINT size; int id; }; //size 0 means free
+static std::vector<_TestTraceOp> s_testTrace;
+static std::vector<void*> s_testTraceLive; //index = id
+
+static void* _TestTraceMalloc(size_t size, void*) {
+	void* p = malloc(size);
+	s_testTrace.push_back({ (UINT)size, (int)s_testTraceLive.size() });
+	s_testTraceLive.push_back(p);
+	return p;
+}
+
+static void _TestTraceFree(void* p, void*) {
+	if (p == null) return;
+	for (int i = 0; i < (int)s_testTraceLive.size(); i++) if (s_testTraceLive[i] == p) { s_testTrace.push_back({ 0, i }); s_testTraceLive[i] = null; break; }
+	free(p);
+}
+
+//Records PCRE memory allocations of interleaved match data and growing heap frames. Replays the trace many times with SlabPool and malloc. Verifies memory contents and stats. Prints times and stats.
+EXPORT void Cpp_TestSlabPool() {
+	s_testTrace.clear(); s_testTraceLive.clear();
+	auto gc = pcre2_general_context_create_16(_TestTraceMalloc, _TestTraceFree, null);
+	static const STR a[] = { L"(\\w+) (\\d+)", L"^((a)|b)*+$", L"(a)(b)(c)(d)(e)(f)(g)(h)(i)?", L"(?:a|b)*c" };
+	pcre2_code_16* codes[_countof(a)];
+	for (int i = 0; i < _countof(a); i++) codes[i] = str::pcre::Compile(a[i], wcslen(a[i]));
+	Buffer<WCHAR, 1> subject(20001); for (int i = 0; i < 20000; i++) subject[i] = 'a'; subject[20000] = 0;
+	for (int len = 100; len <= 20000; len *= 2) {
+		pcre2_match_data_16* md[_countof(a)];
+		for (int i = 0; i < _countof(a); i++) md[i] = pcre2_match_data_create_from_pattern_16(codes[i], gc);
+		for (int i = 0; i < _countof(a); i++) {
+			pcre2_match_16(codes[i], (PCRE2_SPTR16)(WCHAR*)subject, len, 0, 0, md[i], null, null);
+			if (i % 2) { pcre2_match_data_free_16(md[i - 1]); md[i - 1] = null; }
+		}
+		for (auto m : md) if (m) pcre2_match_data_free_16(m);
+	}
+	pcre2_general_context_free_16(gc);
+	for (auto c : codes) str::pcre::Free(c);
+
+	const int nTrace = (int)s_testTrace.size(), nIds = (int)s_testTraceLive.size(), nRep = 1000;
+	std::vector<LPBYTE> p(nIds);
+	for (int pool = 1; pool >= 0; pool--) {
+		SlabPool sp;
+		int nBad = 0;
+		Perf.First();
+		for (int rep = 0; rep < nRep; rep++) {
+			for (auto& op : s_testTrace) {
+				if (op.size) {
+					LPBYTE m = (LPBYTE)(pool ? sp.Alloc(op.size) : malloc(op.size));
+					m[0] = m[op.size - 1] = (BYTE)op.id;
+					p[op.id] = m;
+				} else {
+					LPBYTE m = p[op.id];
+					if (m[0] != (BYTE)op.id) nBad++;
+					if (pool) sp.Free(m); else free(m);
+				}
+			}
+		}
+		Perf.Next('r');
+		auto t = sp.GetStats();
+		if (pool) {
+			if (t.live != 0) nBad++;
+			Printf(L"trace=%i reserved=%i peakReserved=%i peakLive=%i nChunks=%i nLargeCached=%i fragmentation at peak=%.2f",
+				nTrace, (int)t.reserved, (int)t.peakReserved, (int)t.peakLive, t.nChunks, t.nLargeCached, 1 - (double)t.peakLive / t.peakReserved);
+		}
+		Printf(L"%s nBad=%i", pool ? L"SlabPool" : L"malloc", nBad);
+		Perf.Write();
+	}
+}
+
+EXPORT int Cpp_RegexMemoryStats(SlabPool::Stats& r);
+
+static void _TestPrintRegexMemoryStats(STR name) {
+	SlabPool::Stats t; int nThreads = Cpp_RegexMemoryStats(t);
+	Printf(L"%-8s threads=%i reserved=%i live=%i peakReserved=%i peakLive=%i nAlloc=%lld nFree=%lld largest=%i nChunks=%i nLargeCached=%i",
+		name, nThreads, (int)t.reserved, (int)t.live, (int)t.peakReserved, (int)t.peakLive, t.nAlloc, t.nFree, (int)t.largest, t.nChunks, t.nLargeCached);
+}
+
+//Prints Cpp_RegexMemoryStats before and after matching in this thread and in 4 temporary threads.
+EXPORT void Cpp_TestRegexMemoryStats() {
+	_TestPrintRegexMemoryStats(L"start");
+	const int n = 10000;
+	Buffer<WCHAR, 1> s(n); for (int i = 0; i < n; i++) s[i] = 'a';
+	auto code = str::pcre::Compile(L"^((a)|b)*+$", 11);
+	str::pcre::Match(code, s, n);
+	_TestPrintRegexMemoryStats(L"match");
+	Buffer<str::pcre::RegexSubject> a(8000); for (int i = 0; i < 8000; i++) a[i] = { s, (size_t)(i % 8 + 1) * 1000 };
+	Buffer<str::pcre::RegexBatchResult> r(8000);
+	Cpp_RegexMatchBatch(code, a, 8000, 0, r, null, 0, 4, null);
+	_TestPrintRegexMemoryStats(L"threads");
+	str::pcre::Free(code);
+}
+
+EXPORT __int64 Cpp_RegexTrim(bool allThreads);
+
+//Grows heap frames in this thread, then prints Cpp_RegexMemoryStats after automatic trimming and after Cpp_RegexTrim.
+EXPORT void Cpp_TestRegexTrim() {
+	const int n = 1000;
+	Buffer<WCHAR, 1> s(n); for (int i = 0; i < n; i++) s[i] = 'a';
+	auto heavy = str::pcre::Compile(L"^((a)|b)*$", 10), light = str::pcre::Compile(L"(\\w+) (\\d+)", 11);
+	str::pcre::Match(heavy, s, n);
+	_TestPrintRegexMemoryStats(L"heavy");
+	for (int i = 0; i < 1000; i++) str::pcre::Match(light, L"abc 12", 6);
+	_TestPrintRegexMemoryStats(L"auto");
+	str::pcre::Match(heavy, s, n);
+	_TestPrintRegexMemoryStats(L"heavy");
+	auto freed = Cpp_RegexTrim(true);
+	_TestPrintRegexMemoryStats(L"trim");
+	Printf(L"freed=%lld", freed);
+	str::pcre::Free(heavy); str::pcre::Free(light);
+}
+
+EXPORT int Cpp_RegexMatchBudget(pcre2_code_16* code, STR s, size_t len, size_t start, UINT flags,
+	int(*callout)(pcre2_callout_block*, void*), str::pcre::RegexMatch* m, bool needM, const str::pcre::RegexBudget& budget, BSTR* errStr);
+
+//Matches a catastrophic pattern with various budgets. Prints results and times.
+EXPORT void Cpp_TestRegexBudget() {
+	auto code = str::pcre::Compile(L"^(a+)+$", 7);
+	WCHAR s[42]; for (int i = 0; i < 40; i++) s[i] = 'a'; s[40] = 'b'; s[41] = 0;
+	static const str::pcre::RegexBudget a[] = { { 10000 }, { 0xffffffff, 0, 0, 10 }, { 0xffffffff, 0, 0, 100 }, { 0, 0, 0, 1000 }, {} };
+	for (auto& b : a) {
+		str::pcre::RegexMatch m; Bstr e;
+		Perf.First();
+		int R = Cpp_RegexMatchBudget(code, s, 41, 0, 0, null, &m, true, b, &e);
+		Perf.Next();
+		Printf(L"matchLimit=%u timeoutMs=%u  R=%i  %s", b.matchLimit, b.timeoutMs, R, e ? e.m_str : L"");
+		Perf.Write();
+	}
+	str::pcre::Free(code);
+}
+
+EXPORT str::pcre::RegexStream* Cpp_RegexStreamStart(pcre2_code_16* code, UINT flags);
+EXPORT int Cpp_RegexStreamFeed(str::pcre::RegexStream* t, STR s, size_t len, bool last, str::pcre::RegexSpan*& vec, int& vecCount, BSTR* errStr);
+EXPORT void Cpp_RegexStreamEnd(str::pcre::RegexStream* t);
+
+//Finds all matches in a log-like text with Cpp_RegexStreamFeed (chunks of 4096 and 7 characters), and with Cpp_RegexFindAllNext. Compares results and speed.
+//Also compares results of some patterns that match empty strings or use lookbehind.
+EXPORT void Cpp_TestRegexStream() {
+	str::StringBuilder b;
+	for (int i = 0; i < 20000; i++) b << L"2024-01-01 12:00:0" << (i % 10) << L" INFO item " << (i % 7) << L"\r\n";
+	STR s = b; size_t len = b.Length();
+	static const STR a[] = { L"item (\\d)", L"", L"(*CRLF)x*", L"(?m)^", L"\\b", L"(?<=INFO )\\w+", L"\\d+\\r\\n\\d+" };
+	for (int j = 0; j < _countof(a); j++) {
+		auto code = str::pcre::Compile(a[j], wcslen(a[j]));
+		POINT* v; int vc;
+		Perf.First();
+		auto f = Cpp_RegexFindAllStart(code, s, len, 0, 0, null);
+		int n1 = Cpp_RegexFindAllNext(f, 0, v, vc, null);
+		Perf.Next('a');
+		int n2 = 0, n3 = 0, nBad = 0;
+		for (size_t chunk : { 4096, 7 }) {
+			int& n = chunk == 4096 ? n2 : n3;
+			auto t = Cpp_RegexStreamStart(code, 0);
+			for (size_t i = 0; ; i += chunk) {
+				size_t k = min(chunk, len - i); bool last = i + k == len;
+				str::pcre::RegexSpan* r; int rc;
+				int nr = Cpp_RegexStreamFeed(t, s + i, k, last, r, rc, null);
+				for (int m = 0; m < nr; m++, n++) {
+					if (n >= n1 || r[m * rc].start != v[n * vc].x || r[m * rc].end != v[n * vc].y) nBad++;
+				}
+				if (last) break;
+			}
+			Cpp_RegexStreamEnd(t);
+			Perf.Next(chunk == 4096 ? 's' : '7');
+		}
+		Cpp_RegexFindAllEnd(f);
+		str::pcre::Free(code);
+		Printf(L"%-16s  n=%i %i %i, nBad=%i", a[j], n1, n2, n3, nBad);
+		Perf.Write();
+	}
+}
+
+HRESULT AccFind(AccFindCallback& callback, HWND w, Cpp_Acc* aParent, const Cpp_AccFindParams& ap, out BSTR& errStr, AccFindPosition* pos = null);
+
+//Runs typical AccFinder searches in an AO tree recorded with Cpp_AccMemSave (file), or in a generated tree of nNodes AO (file null).
+//Prints times, nodes visited per second, CRT heap calls per visited node, and counts of IAccessible calls.
+EXPORT void Cpp_TestAccFindTree(STR file, int nNodes) {
+	Smart<IAccessible> root;
+	HRESULT hr = file ? AccMemLoad(file, &root) : AccMemGenerate(nNodes ? nNodes : 100000, &root);
+	if (hr) { Printf(L"failed to load the tree: 0x%X", hr); return; }
+
+	static const WCHAR propValue[] = L"value=https://www.example.com/99999";
+	static const WCHAR propDesc[] = L"desc=Not found"; //rarely matches; the planner should evaluate it before name
+	struct _Case { STR title, role, name, prop; int propLength; bool findAll; };
+	static const _Case a[] = {
+		{ L"not found (full traversal)", L"PUSHBUTTON", L"Not found", null, 0, false },
+		{ L"find all LINK", L"LINK", null, null, 0, true },
+		{ L"name wildcard", null, L"*level 9*", null, 0, true },
+		{ L"name regex", L"STATICTEXT", L"**r ^Item \\d+9 level", null, 0, true },
+		{ L"value", L"LINK", null, propValue, _countof(propValue) - 1, false },
+		{ L"name and desc (planner)", null, L"*level*", propDesc, _countof(propDesc) - 1, true },
+	};
+
+	auto hook = [](int allocType, void* userData, size_t size, int blockType, long requestNumber, const unsigned char* filename, int lineNumber) -> int {
+		if (blockType != _CRT_BLOCK) s_nHeapCalls++;
+		return TRUE;
+	};
+
+	for (auto& x : a) {
+		Cpp_AccFindParams ap;
+		if (x.role) { ap.role = x.role; ap.roleLength = (int)wcslen(x.role); }
+		if (x.name) { ap.name = x.name; ap.nameLength = (int)wcslen(x.name); }
+		ap.prop = x.prop; ap.propLength = x.propLength;
+		int nFound = 0;
+		AccFindCallback callback = [&nFound, &x](Cpp_Acc a, int state, int nSiblings) {
+			nFound++;
+			return x.findAll ? eAccFindCallbackResult::Continue : eAccFindCallbackResult::StopFound;
+		};
+
+		AccMemCounters c;
+		AccMemGetCounters(out c, true);
+		s_nHeapCalls = 0;
+		Cpp_Acc aRoot(root, 0);
+		Bstr es;
+		LARGE_INTEGER f, t0, t1; QueryPerformanceFrequency(&f);
+		auto oldHook = _CrtSetAllocHook(hook);
+		QueryPerformanceCounter(&t0);
+		hr = AccFind(callback, 0, &aRoot, ap, es.m_str);
+		QueryPerformanceCounter(&t1);
+		_CrtSetAllocHook(oldHook);
+		if (es) Print(es);
+		AccMemGetCounters(out c, false);
+
+		double sec = (double)(t1.QuadPart - t0.QuadPart) / f.QuadPart, nVisited = (double)max(c.nRole, 1);
+		Printf(L"%s: hr=0x%X, found %i, visited %lld, %.0f ms, %.0f nodes/s, heap calls/node %.2f", x.title, hr, nFound, c.nRole, sec * 1000, nVisited / max(sec, 1e-9), s_nHeapCalls / nVisited);
+		Printf(L"\tIAccessible calls: children %lld, state %lld, rect %lld, name %lld, other props %lld, objects %lld", c.nChildren, c.nState, c.nRect, c.nName, c.nProps, c.nObjects);
+	}
+}
+
+//Compares results and speed of the single-thread and parallel (flag Parallel) AccFinder search in a generated tree of nNodes AO.
+//latency - simulated latency of each IAccessible call, in microseconds, like of cross-process calls. Busy-waits, therefore the machine should have more CPU cores than the number of worker threads.
+EXPORT void Cpp_TestAccFindParallel(int nNodes, int latency) {
+	Smart<IAccessible> root;
+	if (AccMemGenerate(nNodes ? nNodes : 10000, &root)) return;
+	AccMemSetLatency(latency);
+
+	struct _Case { STR title, role, name; int skip; bool findAll; eAF flags; };
+	static const _Case a[] = {
+		{ L"not found", L"PUSHBUTTON", L"Not found", 0, false },
+		{ L"find all LINK", L"LINK", null, 0, true },
+		{ L"first LINK level 9", L"LINK", L"*level 9", 0, false },
+		{ L"skip 5", L"STATICTEXT", L"*level 8", 5, false },
+		{ L"find all reverse", L"PUSHBUTTON", L"*level 7", 0, true, eAF::Reverse },
+	};
+
+	for (auto& x : a) {
+		std::vector<std::wstring> results[2];
+		for (int k = 0; k < 2; k++) {
+			Cpp_AccFindParams ap;
+			if (x.role) { ap.role = x.role; ap.roleLength = (int)wcslen(x.role); }
+			if (x.name) { ap.name = x.name; ap.nameLength = (int)wcslen(x.name); }
+			ap.flags = x.flags | (k ? eAF::Parallel : eAF{});
+			ap.flags2 = eAF2::NotInProc;
+			int skip = x.skip;
+			auto& r = results[k];
+			AccFindCallback callback = [&](Cpp_Acc a, int state, int nSiblings) {
+				if (!x.findAll && skip-- > 0) return eAccFindCallbackResult::Continue;
+				Bstr b; a.acc->get_accName(ao::VE(a.elem), &b);
+				r.push_back(b ? b.m_str : L"");
+				return x.findAll ? eAccFindCallbackResult::Continue : eAccFindCallbackResult::StopFound;
+			};
+
+			Cpp_Acc aRoot(root, 0);
+			Bstr es;
+			if (k == 0) Perf.First();
+			AccFind(callback, 0, &aRoot, ap, es.m_str);
+			Perf.Next(k ? 'P' : 'S');
+		}
+		bool same = results[0] == results[1];
+		Printf(L"%s: found %i, %s", x.title, (int)results[0].size(), same ? L"same results" : L"DIFFERENT RESULTS");
+		if (!same) Printf(L"\tsingle-thread found %i, first \"%s\"; parallel found %i, first \"%s\"", (int)results[0].size(), results[0].size() ? results[0][0].c_str() : L"", (int)results[1].size(), results[1].size() ? results[1][0].c_str() : L"");
+		Perf.Write();
+	}
+	AccMemSetLatency(0);
+}
+
+//Compares results and speed of repeated finds in window w with and without flag Cache.
+//w must be a window of this thread (the cache is used only inproc), eg a window created by the test script. Can change its UI elements while testing.
+EXPORT void Cpp_TestAccFindCache(HWND w, STR role, STR name, int nPolls) {
+	for (int i = 0; i < max(nPolls, 1); i++) {
+		std::vector<std::wstring> results[2];
+		for (int k = 0; k < 2; k++) {
+			Cpp_AccFindParams ap;
+			if (role) { ap.role = role; ap.roleLength = (int)wcslen(role); }
+			if (name) { ap.name = name; ap.nameLength = (int)wcslen(name); }
+			if (k) ap.flags = eAF::Cache;
+			auto& r = results[k];
+			AccFindCallback callback = [&r](Cpp_Acc a, int state, int nSiblings) {
+				Bstr b; a.acc->get_accName(ao::VE(a.elem), &b);
+				r.push_back(b ? b.m_str : L"");
+				return eAccFindCallbackResult::Continue;
+			};
+
+			Bstr es;
+			if (k == 0) Perf.First();
+			AccFind(callback, w, null, ap, es.m_str);
+			Perf.Next(k ? 'C' : 'N');
+			if (es) Print(es);
+		}
+		bool same = results[0] == results[1];
+		Printf(L"poll %i: found %i, %s", i, (int)results[0].size(), same ? L"same results" : L"DIFFERENT RESULTS");
+		Perf.Write();
+
+		MSG m; while (PeekMessageW(&m, 0, 0, 0, PM_REMOVE)) DispatchMessageW(&m); //let the window update
+		Sleep(100);
+	}
+}
+
+//Compares results of find-all in a single call and in chunks of maxFound AO, where each AccFind continues from the AccFindPosition where the previous stopped. Uses a generated tree of nNodes AO.
+EXPORT void Cpp_TestAccFindChunks(int nNodes, int maxFound) {
+	Smart<IAccessible> root;
+	if (AccMemGenerate(nNodes ? nNodes : 10000, &root)) return;
+
+	struct _Case { STR title, role, name; eAF flags; };
+	static const _Case a[] = {
+		{ L"all LINK", L"LINK", null },
+		{ L"all level 9", null, L"*level 9" },
+		{ L"all reverse", L"PUSHBUTTON", null, eAF::Reverse },
+	};
+
+	for (auto& x : a) {
+		Cpp_AccFindParams ap;
+		if (x.role) { ap.role = x.role; ap.roleLength = (int)wcslen(x.role); }
+		if (x.name) { ap.name = x.name; ap.nameLength = (int)wcslen(x.name); }
+		ap.flags = x.flags;
+		std::vector<std::wstring> results[2];
+		int nCalls = 0;
+		for (int k = 0; k < 2; k++) {
+			auto& r = results[k];
+			AccFindCallback callback = [&r](Cpp_Acc a, int state, int nSiblings) {
+				Bstr b; a.acc->get_accName(ao::VE(a.elem), &b);
+				r.push_back(b ? b.m_str : L"");
+				return eAccFindCallbackResult::Continue;
+			};
+
+			AccFindPosition pos; pos.maxFound = max(maxFound, 1); pos.depth = 0;
+			do {
+				Cpp_Acc aRoot(root, 0);
+				Bstr es;
+				AccFind(callback, 0, &aRoot, ap, es.m_str, k ? &pos : null);
+				if (es) { Print(es); break; }
+				if (k) nCalls++;
+			} while (k && pos.depth > 0);
+		}
+		bool same = results[0] == results[1];
+		Printf(L"%s: found %i, %i calls, %s", x.title, (int)results[0].size(), nCalls, same ? L"same results" : L"DIFFERENT RESULTS");
+		if (!same) Printf(L"\tsingle call found %i; chunks found %i", (int)results[0].size(), (int)results[1].size());
+	}
+}
+
 EXPORT void Cpp_TestPCRE(STR s, STR p, DWORD flags) {
 	int rc = 0;
 
@@ -179,7 +179,9 @@ pcre2_match_context PRIV(default_match_context) = {
   PCRE2_UNSET,   /* Offset limit */
   HEAP_LIMIT,
   MATCH_LIMIT,
-  MATCH_LIMIT_DEPTH };
+  MATCH_LIMIT_DEPTH,
+  NULL,          /* Periodic callout function */ //au
+  NULL };        /* Periodic callout data */ //au
 
 /* The create function copies the default into the new memory, but must
 override the default memory handling functions if a gcontext was provided. */
@@ -498,6 +500,16 @@ mcontext->depth_limit = limit;
 return 0;
 }
 
+//au
+PCRE2_EXP_DEFN int PCRE2_CALL_CONVENTION
+pcre2_set_periodic_callout(pcre2_match_context *mcontext,
+  int (*periodic_callout)(void *), void *periodic_callout_data)
+{
+mcontext->periodic_callout = periodic_callout;
+mcontext->periodic_callout_data = periodic_callout_data;
+return 0;
+}
+
 PCRE2_EXP_DEFN int PCRE2_CALL_CONVENTION
 pcre2_set_offset_limit(pcre2_match_context *mcontext, PCRE2_SIZE limit)
 {
@@ -601,6 +601,8 @@ typedef struct pcre2_real_match_context {
   uint32_t heap_limit;
   uint32_t match_limit;
   uint32_t depth_limit;
+  int        (*periodic_callout)(void *); //au
+  void        *periodic_callout_data; //au
 } pcre2_real_match_context;
 
 /* The real convert context structure. */
@@ -936,6 +938,9 @@ typedef struct match_block {
   pcre2_callout_block *cb;        /* Points to a callout block */
   void  *callout_data;            /* To pass back to callouts */
   int (*callout)(pcre2_callout_block *,void *);  /* Callout function or NULL */
+  int (*periodic_callout)(void *); //au
+  void *periodic_callout_data; //au
+  uint32_t periodic_count; //au: frames since pcre2_match started. Unlike match_call_count, not reset for each start position.
 } match_block;
 
 /* A similar structure is used for the same purpose by the DFA matching
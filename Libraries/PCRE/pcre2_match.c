@@ -803,6 +803,13 @@ opcodes. */
 if (mb->match_call_count++ >= mb->match_limit) return PCRE2_ERROR_MATCHLIMIT;
 if (Frdepth >= mb->match_limit_depth) return PCRE2_ERROR_DEPTHLIMIT;
 
+//au: periodic callout, eg to check a deadline
+if (mb->periodic_callout != NULL && (++mb->periodic_count & 0xfff) == 0)
+  {
+  int prc = mb->periodic_callout(mb->periodic_callout_data);
+  if (prc != 0) return prc;
+  }
+
 #ifdef DEBUG_SHOW_OPS
 fprintf(stderr, "\n++ New frame: type=0x%x subject offset %ld\n",
   GF_IDMASK(Fgroup_frame_type), Feptr - mb->start_subject);
@@ -7355,6 +7362,10 @@ mb->match_limit = (mcontext->match_limit < re->limit_match)?
 mb->match_limit_depth = (mcontext->depth_limit < re->limit_depth)?
   mcontext->depth_limit : re->limit_depth;
 
+mb->periodic_callout = mcontext->periodic_callout; //au
+mb->periodic_callout_data = mcontext->periodic_callout_data; //au
+mb->periodic_count = 0; //au
+
 /* If a pattern has very many capturing parentheses, the frame size may be very
 large. Set the initial frame vector size to ensure that there are at least 10
 available frames, but enforce a minimum of START_FRAMES_SIZE. If this is